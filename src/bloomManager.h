@@ -19,6 +19,7 @@ public:
     void destroy();
 
     void bind();
+    unsigned int framebuffer() const { return _FBO; }
     const std::vector<BloomMip>& mipChain() const { return _mipChain; }
 
 private:
@@ -15,16 +15,10 @@ bool BloomRenderer::init(unsigned int windowWidth, unsigned int windowHeight) {
     }
 
     // Shaders
-    _downsampleShader = Shader("../src/shaders/scaleCommon.vs", "../src/shaders/downsample.fs");
-    _upsampleShader = Shader("../src/shaders/scaleCommon.vs", "../src/shaders/upsample.fs");
-
-    // Downsample
-    _downsampleShader.use();
-    _downsampleShader.setInt("srcTexture", 0);
-
-    // Upsample
-    _upsampleShader.use();
-    _upsampleShader.setInt("srcTexture", 0);
+    _downsamplePass.init("bloom downsample", "downsample.fs", { "srcTexture" });
+    _downsamplePass.getShader();
+    _upsamplePass.init("bloom upsample", "upsample.fs", { "srcTexture" });
+    _upsamplePass.getShader();
 
     std::cout << "bloom renderer: init with width " << windowWidth << " and height " << windowHeight << std::endl;
 
@@ -35,13 +29,13 @@ bool BloomRenderer::init(unsigned int windowWidth, unsigned int windowHeight) {
 void BloomRenderer::destroy()
 {
     _manager.destroy();
+    _downsamplePass.release();
+    _upsamplePass.release();
     _init = false;
 }
 
 void BloomRenderer::renderBloomTexture(unsigned int srcTexture, float filterRadius)
 {
-    _manager.bind();
-
     renderDownsamples(srcTexture);
     renderUpsamples(filterRadius);
 
@@ -59,12 +53,9 @@ void BloomRenderer::renderDownsamples(unsigned int srcTexture)
 {
     auto mipChain = _manager.mipChain();
 
-    _downsampleShader.use();
-    _downsampleShader.setVec2("srcResolution", _srcViewportSize);
-
-    // Bind srcTexture (HDR color buffer) as initial texture input
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, srcTexture);
+    // srcTexture (HDR color buffer) is the initial input
+    Shader &shader = _downsamplePass.begin(_manager.framebuffer(), { srcTexture });
+    shader.setVec2("srcResolution", _srcViewportSize);
 
     // Progressively downsample through the mip chain
     for (int i = 0; i < mipChain.size(); i++)
@@ -74,22 +65,23 @@ void BloomRenderer::renderDownsamples(unsigned int srcTexture)
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
                                GL_TEXTURE_2D, mip.texture, 0);
 
-        // Render screen-filled quad of resolution of current mip
-        _quad.draw();
+        // Fill the current mip
+        _downsamplePass.draw();
 
         // Set current mip resolution as srcResolution for next iteration
-        _downsampleShader.setVec2("srcResolution", mip.size);
+        shader.setVec2("srcResolution", mip.size);
         // Set current mip as texture input for next iteration
-        glBindTexture(GL_TEXTURE_2D, mip.texture);
+        _downsamplePass.setInput(0, mip.texture);
     }
+    _downsamplePass.end();
 }
 
 void BloomRenderer::renderUpsamples(float filterRadius)
 {
     auto mipChain = _manager.mipChain();
 
-    _upsampleShader.use();
-    _upsampleShader.setFloat("filterRadius", filterRadius);
+    Shader &shader = _upsamplePass.begin(_manager.framebuffer(), {});
+    shader.setFloat("filterRadius", filterRadius);
 
     // Enable additive blending
     glEnable(GL_BLEND);
@@ -102,17 +94,17 @@ void BloomRenderer::renderUpsamples(float filterRadius)
         const BloomMip& nextMip = mipChain[i-1];
 
         // Bind viewport and texture from where to read
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, mip.texture);
+        _upsamplePass.setInput(0, mip.texture);
 
         // Set framebuffer render target (we write to this texture)
         glViewport(0, 0, nextMip.size.x, nextMip.size.y);
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
                                GL_TEXTURE_2D, nextMip.texture, 0);
 
-        // Render screen-filled quad of resolution of current mip
-        _quad.draw();
+        // Fill the next mip
+        _upsamplePass.draw();
     }
+    _upsamplePass.end();
 
     // Disable additive blending
     //glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA); // Restore if this was default
@@ -3,9 +3,8 @@
 
 #include "global.h"
 
-#include "shader.h"
 #include "bloomManager.h"
-#include "screenQuad.h"
+#include "fullscreenPass.h"
 
 class BloomRenderer {
 public:
@@ -26,10 +25,8 @@ private:
     BloomManager _manager;
     glm::ivec2 _srcViewportSize;
     glm::vec2 _srcViewportSizeFloat;
-    Shader _downsampleShader;
-    Shader _upsampleShader;
-    
-    ScreenQuad _quad;
+    FullscreenPass _downsamplePass;
+    FullscreenPass _upsamplePass;
 };
 
 #endif /* __BLOOMRENDERER__ */
@@ -0,0 +1,93 @@
+#include "boundsQueries.h"
+
+void BoundsQueries::init() {
+    if (_init) return;
+
+    // Unit cube, scaled to the bounds in the vertex shader
+    const float vertexData[] = {
+        0.0f, 0.0f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 1.0f,   1.0f, 0.0f, 1.0f,   1.0f, 1.0f, 1.0f,   0.0f, 1.0f, 1.0f,
+    };
+    const unsigned char indexData[] = {
+        0, 2, 1, 0, 3, 2,   4, 5, 6, 4, 6, 7,
+        0, 1, 5, 0, 5, 4,   3, 6, 2, 3, 7, 6,
+        0, 4, 7, 0, 7, 3,   1, 2, 6, 1, 6, 5,
+    };
+
+    glGenVertexArrays(1, &_VAO);
+    glGenBuffers(1, &_VBO);
+    glGenBuffers(1, &_EBO);
+
+    glBindVertexArray(_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, _VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindVertexArray(0);
+
+    _shader = Shader("boundingBox.vs", "boundingBox.fs");
+
+    _init = true;
+}
+
+void BoundsQueries::release() {
+    if (!_init) return;
+
+    glDeleteVertexArrays(1, &_VAO);
+    glDeleteBuffers(1, &_VBO);
+    glDeleteBuffers(1, &_EBO);
+    glDeleteProgram(_shader.ID);
+    if (!_queries.empty()) glDeleteQueries(_queries.size(), _queries.data());
+    _queries.clear();
+
+    _init = false;
+}
+
+void BoundsQueries::begin(const glm::mat4 &viewProjection) {
+    if (!_init) init();
+
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+
+    _shader.use();
+    _shader.setMat4("viewProjection", viewProjection);
+    glBindVertexArray(_VAO);
+}
+
+void BoundsQueries::query(unsigned int slot, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) {
+    while (_queries.size() <= slot) {
+        unsigned int query;
+        glGenQueries(1, &query);
+        _queries.push_back(query);
+    }
+
+    _shader.setVec3("boundsMin", boundsMin);
+    _shader.setVec3("boundsMax", boundsMax);
+
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, _queries[slot]);
+    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, 0);
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+}
+
+void BoundsQueries::end() {
+    glBindVertexArray(0);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+}
+
+bool BoundsQueries::getResult(unsigned int slot, bool &anySamplesPassed) const {
+    if (slot >= _queries.size()) return false;
+
+    unsigned int available = 0;
+    glGetQueryObjectuiv(_queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) return false;
+
+    unsigned int result = 0;
+    glGetQueryObjectuiv(_queries[slot], GL_QUERY_RESULT, &result);
+    anySamplesPassed = result != 0;
+    return true;
+}
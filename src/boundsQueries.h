@@ -0,0 +1,37 @@
+#ifndef __BOUNDSQUERIES__
+#define __BOUNDSQUERIES__
+
+#include "global.h"
+#include "shader.h"
+
+/**
+ * @brief Occlusion queries on world space bounding boxes, drawn against whatever depth
+ * buffer is bound.
+ *
+ * Each box gets a slot holding an ANY_SAMPLES_PASSED query, which can be read back later
+ * or used directly for conditional rendering.
+ */
+class BoundsQueries {
+    bool _init { false };
+    unsigned int _VAO, _VBO, _EBO;
+    Shader _shader;
+    vector<unsigned int> _queries;
+
+public:
+    BoundsQueries() {};
+    void init();
+    // Deletes the box geometry, shader and queries
+    void release();
+
+    // Masks colour and depth writes and sets up the box shader
+    void begin(const glm::mat4 &viewProjection);
+    void query(unsigned int slot, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax);
+    // Restores the write masks
+    void end();
+
+    unsigned int getQuery(unsigned int slot) const { return _queries[slot]; }
+    // Doesn't wait for the GPU - false if the result isn't available yet
+    bool getResult(unsigned int slot, bool &anySamplesPassed) const;
+};
+
+#endif /* __BOUNDSQUERIES__ */
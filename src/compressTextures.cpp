@@ -0,0 +1,47 @@
+#include <cstring>
+
+#include "global.h"
+#include "textureCache.h"
+
+/**
+ * @file compressTextures.cpp
+ * @brief Compresses images into the texture cache and reports their PSNR. Needs no
+ * window or GL context, so it can validate the compressor headlessly.
+ *
+ * Usage: CompressTextures [--fast | --high] [--srgb | --linear | --normal] image...
+ * Options apply to every image after them. Colour images are treated as sRGB by default.
+ */
+
+int main(int argc, char **argv)
+{
+    CompressionQuality quality = CompressionQuality::FAST;
+    MipFilter filter = MipFilter::SRGB;
+    int failures = 0;
+
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0] << " [--fast | --high] [--srgb | --linear | --normal] image..." << std::endl;
+        return 1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--fast") == 0) {
+            quality = CompressionQuality::FAST;
+        } else if (strcmp(argv[i], "--high") == 0) {
+            quality = CompressionQuality::HIGH;
+        } else if (strcmp(argv[i], "--srgb") == 0) {
+            filter = MipFilter::SRGB;
+        } else if (strcmp(argv[i], "--linear") == 0) {
+            filter = MipFilter::LINEAR;
+        } else if (strcmp(argv[i], "--normal") == 0) {
+            filter = MipFilter::NORMAL_MAP;
+        } else {
+            TextureData data;
+            if (!loadTextureData(argv[i], filter, true, quality, data, true)) {
+                std::cout << "Failed to load texture at " << argv[i] << std::endl;
+                failures++;
+            }
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
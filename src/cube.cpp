@@ -61,9 +61,9 @@ Cube::Cube()
         inds.push_back(i);
     }
 
-    Mesh mesh(vertices, inds, {});
-    _model = Model(mesh);
+    Mesh mesh(vertices, inds, nullptr);
+    setModel(Model(mesh));
 
     // Use forward rendering
-    deferred = false;
+    setDeferred(false);
 }
\ No newline at end of file
@@ -7,8 +7,6 @@ class Cube final : public GameObject {
 
 public:
     Cube();
-
-    // void draw(Shader &shader, const Renderer &renderer) override;
 };
 
 #endif /* __CUBE__ */
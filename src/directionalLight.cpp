@@ -28,7 +28,7 @@ DirectionalLight::~DirectionalLight() {
     }
 }
 
-void DirectionalLight::configureForDepthMap(Shader &shader, unsigned int framebuf) {
+void DirectionalLight::configureForDepthMap(Shader &shader, unsigned int framebuf, const glm::mat4 &lightSpaceMatrix) {
     glBindFramebuffer(GL_FRAMEBUFFER, framebuf);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, _shadowMap, 0);
     glDrawBuffer(GL_NONE);
@@ -37,21 +37,21 @@ void DirectionalLight::configureForDepthMap(Shader &shader, unsigned int framebu
     glClear(GL_DEPTH_BUFFER_BIT);
 
     shader.use();
-    shader.setMat4("lightSpaceMatrix", generateProjectionMatrix());
+    shader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
 }
 
-void DirectionalLight::bind(Shader& shader, int &textureInd) {
-    shader.setVec3("dirLight.direction", direction);
+void DirectionalLight::bind(Shader& shader, int &textureInd, const glm::vec3 &lightDirection, const glm::mat4 &lightSpaceMatrix) {
+    shader.setVec3("dirLight.direction", lightDirection);
     shader.setVec3("dirLight.ambient",  _ambientVec);
     shader.setVec3("dirLight.diffuse",  _diffuseVec);
     shader.setVec3("dirLight.specular", _specularVec);
-    shader.setBool("dirLight.castsShadow", _castsShadow);
 
     if (_castsShadow) {
         glActiveTexture(GL_TEXTURE0 + textureInd);
         glBindTexture(GL_TEXTURE_2D, _shadowMap);
         shader.setInt("dirLight.shadowMap", textureInd);
-        shader.setMat4("dirLight.lightSpaceMatrix", generateProjectionMatrix());
+        shader.setVec2("dirLight.shadowTexelSize", 1.0f / SHADOW_WIDTH, 1.0f / SHADOW_HEIGHT);
+        shader.setMat4("dirLight.lightSpaceMatrix", lightSpaceMatrix);
         textureInd++;
     }
 }
@@ -12,8 +12,9 @@ public:
     DirectionalLight(glm::vec3 color, float ambient, float diffuse, float specular, glm::vec3 direction, bool castsShadow);
     ~DirectionalLight();
 
-    void configureForDepthMap(Shader &shader, unsigned int framebuf);
-    void bind(Shader& shader, int &textureInd);
+    // Light state is passed in as it was when the frame was prepared
+    void configureForDepthMap(Shader &shader, unsigned int framebuf, const glm::mat4 &lightSpaceMatrix);
+    void bind(Shader& shader, int &textureInd, const glm::vec3 &lightDirection, const glm::mat4 &lightSpaceMatrix);
     glm::mat4 generateProjectionMatrix();
 };
 
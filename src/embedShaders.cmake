@@ -0,0 +1,36 @@
+# Writes a C++ source holding every file in SHADER_DIR as a constexpr table, so shaders
+# are compiled into the binary instead of being read at startup.
+#
+# Script mode: cmake -DSHADER_DIR=<dir> -DOUTPUT=<file.cpp> -P embedShaders.cmake
+
+file(GLOB SHADER_NAMES RELATIVE ${SHADER_DIR} ${SHADER_DIR}/*)
+list(SORT SHADER_NAMES)
+
+set(TABLE "")
+foreach(NAME ${SHADER_NAMES})
+    file(READ ${SHADER_DIR}/${NAME} SOURCE)
+    string(APPEND TABLE "    { \"${NAME}\", R\"glsl(${SOURCE})glsl\" },\n")
+endforeach()
+
+file(WRITE ${OUTPUT}.tmp
+"// Generated from ${SHADER_DIR} by embedShaders.cmake - do not edit
+#include \"embeddedShaders.h\"
+
+namespace {
+
+constexpr EmbeddedShader EMBEDDED_SHADERS[] = {
+${TABLE}};
+
+}
+
+const EmbeddedShader* findEmbeddedShader(std::string_view name)
+{
+    for (const EmbeddedShader &shader : EMBEDDED_SHADERS) {
+        if (shader.name == name) return &shader;
+    }
+    return nullptr;
+}
+")
+# Only touch the output when a shader changed, so dependents aren't rebuilt needlessly
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different ${OUTPUT}.tmp ${OUTPUT})
+file(REMOVE ${OUTPUT}.tmp)
@@ -0,0 +1,24 @@
+#ifndef __EMBEDDEDSHADERS__
+#define __EMBEDDEDSHADERS__
+
+#include <string_view>
+
+/**
+ * @file embeddedShaders.h
+ * @brief The files in src/shaders, compiled into the binary. The table is generated at
+ * build time by embedShaders.cmake.
+ */
+
+struct EmbeddedShader {
+    std::string_view name;
+    std::string_view source;
+};
+
+/**
+ * @brief Looks up a shader by file name, e.g. "gBuffer.vs".
+ *
+ * @return nullptr if there is no such shader.
+ */
+const EmbeddedShader* findEmbeddedShader(std::string_view name);
+
+#endif /* __EMBEDDEDSHADERS__ */
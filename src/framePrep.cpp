@@ -0,0 +1,26 @@
+#include "framePrep.h"
+
+FramePrep::~FramePrep()
+{
+    // The job writes into this
+    JobSystem::instance().wait(_pending);
+}
+
+void FramePrep::kick(PrepareFunction prepare)
+{
+    JobSystem &jobs = JobSystem::instance();
+    jobs.wait(_pending);
+
+    // The packet isn't shared until wait() returns it
+    RenderPacket *packet = &_packets[_next];
+    jobs.run([prepare = std::move(prepare), packet] { prepare(*packet); }, &_pending);
+}
+
+RenderPacket& FramePrep::wait()
+{
+    JobSystem::instance().wait(_pending);
+
+    RenderPacket &packet = _packets[_next];
+    _next = 1 - _next;
+    return packet;
+}
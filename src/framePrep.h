@@ -0,0 +1,39 @@
+#ifndef __FRAMEPREP__
+#define __FRAMEPREP__
+
+#include "global.h"
+#include <functional>
+
+#include "jobs.h"
+#include "renderPacket.h"
+
+/**
+ * @brief Prepares render packets as a job on the shared pool, double buffered so the GL
+ * thread can submit one packet while the next is built.
+ */
+class FramePrep
+{
+public:
+    using PrepareFunction = std::function<void(RenderPacket&)>;
+
+    FramePrep() {}
+    ~FramePrep();
+    FramePrep(const FramePrep&) = delete;
+    FramePrep& operator=(const FramePrep&) = delete;
+
+    /**
+     * @brief Starts filling the next packet on the job pool. The packet returned by the
+     * previous wait() is left alone.
+     */
+    void kick(PrepareFunction prepare);
+    // Runs jobs until the kicked packet is ready, and returns it. Call once per kick().
+    RenderPacket& wait();
+
+private:
+    RenderPacket _packets[2];
+    unsigned int _next { 0 };
+
+    JobCounter _pending;
+};
+
+#endif /* __FRAMEPREP__ */
@@ -0,0 +1,98 @@
+#include "fullscreenPass.h"
+
+#include <algorithm>
+
+namespace {
+
+// Shared by every pass. Core profiles need a vertex array bound even without attributes.
+unsigned int emptyVAO = 0;
+
+std::map<string, float> timings;
+
+}
+
+void FullscreenPass::init(const string &name, const char *fragmentPath, const vector<string> &inputs) {
+    release();
+    _name = name;
+    _shaders = ShaderVariants("fullscreen.vs", fragmentPath);
+    _inputs = inputs;
+    _configured.clear();
+}
+
+void FullscreenPass::release() {
+    if (_queries[0]) glDeleteQueries(QUERY_COUNT, _queries);
+    for (int i = 0; i < QUERY_COUNT; i++) {
+        _queries[i] = 0;
+        _pending[i] = false;
+    }
+    _next = 0;
+    _timing = false;
+    timings.erase(_name);
+}
+
+void FullscreenPass::releaseShared() {
+    glDeleteVertexArrays(1, &emptyVAO);
+    emptyVAO = 0;
+}
+
+const std::map<string, float>& FullscreenPass::getTimings() {
+    return timings;
+}
+
+/**
+ * @brief Reads the runs whose queries have finished, without waiting for the others.
+ */
+void FullscreenPass::collectTimings() {
+    for (int i = 0; i < QUERY_COUNT; i++) {
+        if (!_pending[i]) continue;
+        GLint available = 0;
+        glGetQueryObjectiv(_queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(_queries[i], GL_QUERY_RESULT, &nanoseconds);
+        _milliseconds = nanoseconds / 1.0e6f;
+        timings[_name] = _milliseconds;
+        _pending[i] = false;
+    }
+}
+
+Shader& FullscreenPass::begin(unsigned int framebuffer, const vector<unsigned int> &textures, const ShaderDefines &defines) {
+    if (!_queries[0]) glGenQueries(QUERY_COUNT, _queries);
+    collectTimings();
+    // Skipped if the GPU is more than QUERY_COUNT runs behind
+    _timing = !_pending[_next];
+    if (_timing) glBeginQuery(GL_TIME_ELAPSED, _queries[_next]);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    Shader &shader = _shaders.get(defines);
+    shader.use();
+    if (std::find(_configured.begin(), _configured.end(), shader.ID) == _configured.end()) {
+        for (unsigned int i = 0; i < _inputs.size(); i++)
+            shader.setInt(_inputs[i], i);
+        _configured.push_back(shader.ID);
+    }
+    for (unsigned int i = 0; i < textures.size() && i < _inputs.size(); i++)
+        setInput(i, textures[i]);
+    return shader;
+}
+
+void FullscreenPass::setInput(unsigned int input, unsigned int texture) const {
+    glActiveTexture(GL_TEXTURE0 + input);
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void FullscreenPass::draw() const {
+    if (!emptyVAO) glGenVertexArrays(1, &emptyVAO);
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+}
+
+void FullscreenPass::end() {
+    if (!_timing) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    _pending[_next] = true;
+    _next = (_next + 1) % QUERY_COUNT;
+    _timing = false;
+}
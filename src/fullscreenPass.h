@@ -0,0 +1,77 @@
+#ifndef __FULLSCREENPASS__
+#define __FULLSCREENPASS__
+
+#include "global.h"
+#include <map>
+
+#include "shaderVariants.h"
+
+/**
+ * @brief Runs a fragment shader over the whole of a framebuffer. The vertex shader is
+ * fullscreen.vs, which makes one triangle covering the screen from gl_VertexID, so no pass
+ * needs vertex buffers of its own.
+ *
+ * Inputs are the fragment shader's samplers, named at creation and bound to texture units
+ * 0, 1, ... in that order. Each program's sampler uniforms are set once, when it is first
+ * used - it may still be building in a ShaderBatch when the pass is created. Defines pick
+ * the program as in ShaderVariants.
+ *
+ * Each begin() to end() is timed on the GPU. The results are read frames later, once
+ * they are ready, so timing never waits for the GPU; see getTimings().
+ *
+ * The timer queries belong to the pass: it can't be copied, and release() deletes them.
+ * The vertex array every pass draws with is deleted by releaseShared(), once no pass will
+ * draw again.
+ *
+ * Usage: init() once, then each frame begin() with the output and inputs, set any other uniforms on the program it
+ * returns, draw() - more than once if the viewport, attachments or inputs change between
+ * draws - then end(). Passes don't nest.
+ */
+class FullscreenPass
+{
+public:
+    FullscreenPass() {}
+    FullscreenPass(const FullscreenPass&) = delete;
+    FullscreenPass& operator=(const FullscreenPass&) = delete;
+
+    // `name` labels its timings
+    void init(const string &name, const char *fragmentPath, const vector<string> &inputs);
+    // Deletes the timer queries
+    void release();
+    // Deletes the vertex array shared by every pass
+    static void releaseShared();
+
+    // Binds `framebuffer`, one texture per input and the program for `defines`
+    Shader& begin(unsigned int framebuffer, const vector<unsigned int> &textures, const ShaderDefines &defines = {});
+    void setInput(unsigned int input, unsigned int texture) const;
+    void draw() const;
+    void end();
+
+    // Builds a program ahead of its first use
+    Shader& getShader(const ShaderDefines &defines = {}) { return _shaders.get(defines); }
+    // Milliseconds on the GPU of the latest timed run, 0 until one is ready
+    float getMilliseconds() const { return _milliseconds; }
+
+    // The latest time of every pass which has been timed, by name
+    static const std::map<string, float>& getTimings();
+
+private:
+    // Runs timed at once, before the oldest must be ready
+    static const int QUERY_COUNT = 3;
+
+    string _name;
+    ShaderVariants _shaders;
+    vector<string> _inputs;
+    // Programs whose samplers are set
+    vector<unsigned int> _configured;
+
+    unsigned int _queries[QUERY_COUNT] {};
+    bool _pending[QUERY_COUNT] {};
+    unsigned int _next { 0 };
+    bool _timing { false };
+    float _milliseconds { 0.0f };
+
+    void collectTimings();
+};
+
+#endif /* __FULLSCREENPASS__ */
@@ -1,23 +1,33 @@
 #include "gameObject.h"
-#include "renderer.h"
 
 using std::string;
 
+GameObject::GameObject() {
+    _handle = SceneStore::instance().create(&_model);
+}
+
 GameObject::GameObject(Model &model) {
     _model = model;
+    _handle = SceneStore::instance().create(&_model);
+}
+
+GameObject::GameObject(string modelPath, VertexFormat format, unsigned int lodCount) {
+    _model = Model(modelPath, format, lodCount);
+    _handle = SceneStore::instance().create(&_model);
 }
 
-GameObject::GameObject(string modelPath) {
-    _model = Model(modelPath);
+GameObject::~GameObject() {
+    SceneStore::instance().destroy(_handle);
+}
+
+void GameObject::setModel(const Model &model) {
+    _model = model;
+
+    glm::vec3 boundsMin, boundsMax;
+    _model.getBounds(boundsMin, boundsMax);
+    SceneStore::instance().setLocalBounds(_handle, boundsMin, boundsMax);
 }
 
-void GameObject::draw(Shader &shader, const Renderer &renderer) {
-    glm::mat4 modelMatrix = glm::mat4(1.0f);
-    modelMatrix = glm::translate(modelMatrix, position);
-    modelMatrix = glm::scale(modelMatrix, scale);
-    modelMatrix = glm::rotate(modelMatrix, rotation.x, glm::vec3(1.0f, 0.0f, 0.0f)); 
-    modelMatrix = glm::rotate(modelMatrix, rotation.y, glm::vec3(0.0f, 1.0f, 0.0f)); 
-    modelMatrix = glm::rotate(modelMatrix, rotation.z, glm::vec3(0.0f, 0.0f, 1.0f)); 
-    shader.setMat4("model", modelMatrix);
-    _model.draw(shader);
+void GameObject::setParent(GameObject *parent) {
+    SceneStore::instance().setParent(_handle, parent ? parent->_handle : SceneHandle());
 }
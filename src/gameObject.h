@@ -6,29 +6,63 @@
 
 #include "model.h"
 #include "shader.h"
+#include "sceneStore.h"
 
-class Renderer;
-
+/**
+ * @brief A model placed in the scene.
+ *
+ * GameObject owns the model; its transform, flags and cached matrices live in the
+ * SceneStore, and this class only forwards to it. Objects can be parented to other
+ * objects, in which case their transform is relative to the parent.
+ */
 class GameObject {
 protected:
     Model _model;
+    SceneHandle _handle;
 
-public:
-    glm::vec3 position;
-    glm::vec3 scale { glm::vec3(1.0f) };
-    glm::vec3 rotation;
-
-    bool castsShadow { true };
-    bool deferred { true };
+    // Replaces the model, updating the object's bounds
+    void setModel(const Model &model);
 
 public:
-    GameObject() {};
+    GameObject();
     GameObject(Model &model);
-    GameObject(string modelPath);
+    GameObject(string modelPath, VertexFormat format = VertexFormat(), unsigned int lodCount = 0);
+    virtual ~GameObject();
+
+    // The store holds a pointer to the model
+    GameObject(const GameObject&) = delete;
+    GameObject& operator=(const GameObject&) = delete;
+
+    SceneHandle getHandle() const { return _handle; }
+
+    // Local transform, relative to the parent
+    void setPosition(const glm::vec3 &position) { SceneStore::instance().setPosition(_handle, position); }
+    void setScale(const glm::vec3 &scale) { SceneStore::instance().setScale(_handle, scale); }
+    void setRotation(const glm::vec3 &rotation) { SceneStore::instance().setRotation(_handle, rotation); }
+    const glm::vec3& getPosition() const { return store().getPosition(index()); }
+    const glm::vec3& getScale() const { return store().getScale(index()); }
+    const glm::vec3& getRotation() const { return store().getRotation(index()); }
+
+    /**
+     * @brief Attaches this object to `parent`, or detaches it if null. Children are
+     * detached when their parent is destroyed.
+     */
+    void setParent(GameObject *parent);
+
+    void setCastsShadow(bool value) { SceneStore::instance().setFlag(_handle, SceneStore::CASTS_SHADOW, value); }
+    bool getCastsShadow() const { return store().getFlags(index()) & SceneStore::CASTS_SHADOW; }
+    void setDeferred(bool value) { SceneStore::instance().setFlag(_handle, SceneStore::DEFERRED, value); }
+    bool getDeferred() const { return store().getFlags(index()) & SceneStore::DEFERRED; }
+    void setOccluder(bool value) { SceneStore::instance().setFlag(_handle, SceneStore::OCCLUDER, value); }
+    bool getOccluder() const { return store().getFlags(index()) & SceneStore::OCCLUDER; }
 
-    virtual void draw(Shader &shader, const Renderer &renderer);
+    // Updated by the renderer once per frame
+    const glm::mat4& getWorldMatrix() const { return store().getWorldMatrix(index()); }
+    const glm::mat3& getNormalMatrix() const { return store().getNormalMatrix(index()); }
 
-    // virtual void preRenderLoop(Shader &shader)
+private:
+    static const SceneStore& store() { return SceneStore::instance(); }
+    unsigned int index() const { return store().indexOf(_handle); }
 };
 
 #endif /* __GAMEOBJECT__ */
@@ -0,0 +1,198 @@
+#include "geometryPool.h"
+
+#include <algorithm>
+
+namespace {
+
+// Initial sizes, in vertices and indices
+const unsigned int INITIAL_VERTEX_CAPACITY = 1 << 16;
+const unsigned int INITIAL_INDEX_CAPACITY = 1 << 18;
+
+/**
+ * @brief Replaces `buffer` with a larger one bound to `target`, keeping its contents.
+ */
+unsigned int growBuffer(GLenum target, unsigned int buffer, size_t oldSize, size_t newSize) {
+    unsigned int grown;
+    glGenBuffers(1, &grown);
+    glBindBuffer(target, grown);
+    glBufferData(target, newSize, nullptr, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, target, 0, 0, oldSize);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    glDeleteBuffers(1, &buffer);
+    return grown;
+}
+
+// Every pool, one per format. They live until exit, but their GL objects go in releaseAll().
+vector<std::unique_ptr<GeometryPool>>& allPools() {
+    static vector<std::unique_ptr<GeometryPool>> pools;
+    return pools;
+}
+
+}
+
+RangeAllocator::RangeAllocator(unsigned int capacity)
+: _capacity(capacity)
+{
+    if (capacity > 0) _free[0] = capacity;
+}
+
+bool RangeAllocator::allocate(unsigned int size, unsigned int &offset)
+{
+    if (size == 0) return false;
+
+    for (auto it = _free.begin(); it != _free.end(); it++) {
+        if (it->second < size) continue;
+
+        offset = it->first;
+        unsigned int remaining = it->second - size;
+        _free.erase(it);
+        if (remaining > 0) _free[offset + size] = remaining;
+        _used += size;
+        return true;
+    }
+    return false;
+}
+
+void RangeAllocator::release(unsigned int offset, unsigned int size)
+{
+    if (size == 0) return;
+    _used -= size;
+
+    auto next = _free.lower_bound(offset);
+
+    // Merge with the following range
+    if (next != _free.end() && offset + size == next->first) {
+        size += next->second;
+        next = _free.erase(next);
+    }
+
+    // Merge with the preceding range
+    if (next != _free.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            previous->second += size;
+            return;
+        }
+    }
+
+    _free[offset] = size;
+}
+
+void RangeAllocator::grow(unsigned int capacity)
+{
+    if (capacity <= _capacity) return;
+
+    unsigned int added = capacity - _capacity;
+    unsigned int offset = _capacity;
+    _capacity = capacity;
+    // Counted as used until release() hands it to the free list
+    _used += added;
+    release(offset, added);
+}
+
+GeometryPool& GeometryPool::forFormat(const VertexFormat &format)
+{
+    vector<std::unique_ptr<GeometryPool>> &pools = allPools();
+    for (auto &pool : pools) {
+        if (pool->getFormat() == format) return *pool;
+    }
+    pools.push_back(std::make_unique<GeometryPool>(format));
+    return *pools.back();
+}
+
+GeometryPool::GeometryPool(const VertexFormat &format)
+: _format(format), _vertices(INITIAL_VERTEX_CAPACITY), _indices(INITIAL_INDEX_CAPACITY)
+{
+    glGenVertexArrays(1, &_VAO);
+    glGenBuffers(1, &_VBO);
+    glGenBuffers(1, &_EBO);
+
+    glBindVertexArray(_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, _VBO);
+    glBufferData(GL_ARRAY_BUFFER, (size_t)INITIAL_VERTEX_CAPACITY * _format.stride(), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (size_t)INITIAL_INDEX_CAPACITY * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+
+    // positions, normals, texture coords, tangents
+    _format.configureAttributes();
+
+    glBindVertexArray(0);
+}
+
+void GeometryPool::releaseAll()
+{
+    for (auto &pool : allPools()) {
+        glDeleteVertexArrays(1, &pool->_VAO);
+        glDeleteBuffers(1, &pool->_VBO);
+        glDeleteBuffers(1, &pool->_EBO);
+        pool->_VAO = pool->_VBO = pool->_EBO = 0;
+    }
+}
+
+GeometryAllocation GeometryPool::allocate(const vector<unsigned char> &vertexData, const vector<unsigned int> &indices)
+{
+    GeometryAllocation allocation;
+    unsigned int vertexCount = vertexData.size() / _format.stride();
+    unsigned int indexCount = indices.size();
+    if (vertexCount == 0 || indexCount == 0) return allocation;
+
+    while (!_vertices.allocate(vertexCount, allocation.baseVertex)) {
+        growVertices(std::max(_vertices.getCapacity() * 2, _vertices.getCapacity() + vertexCount));
+    }
+    while (!_indices.allocate(indexCount, allocation.firstIndex)) {
+        growIndices(std::max(_indices.getCapacity() * 2, _indices.getCapacity() + indexCount));
+    }
+    allocation.vertexCount = vertexCount;
+    allocation.indexCount = indexCount;
+
+    glBindBuffer(GL_ARRAY_BUFFER, _VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, (size_t)allocation.baseVertex * _format.stride(), vertexData.size(), vertexData.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // The element buffer is VAO state
+    glBindVertexArray(_VAO);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (size_t)allocation.firstIndex * sizeof(unsigned int), 
+                    indexCount * sizeof(unsigned int), indices.data());
+    glBindVertexArray(0);
+
+    return allocation;
+}
+
+void GeometryPool::release(GeometryAllocation &allocation)
+{
+    if (!allocation.valid()) return;
+
+    _vertices.release(allocation.baseVertex, allocation.vertexCount);
+    _indices.release(allocation.firstIndex, allocation.indexCount);
+    allocation = GeometryAllocation();
+}
+
+void GeometryPool::growVertices(unsigned int capacity)
+{
+    std::cout << "Growing geometry pool to " << capacity << " vertices" << std::endl;
+
+    _VBO = growBuffer(GL_ARRAY_BUFFER, _VBO, (size_t)_vertices.getCapacity() * _format.stride(), 
+                      (size_t)capacity * _format.stride());
+    _vertices.grow(capacity);
+
+    // Attribute pointers still reference the old buffer
+    glBindVertexArray(_VAO);
+    _format.configureAttributes();
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryPool::growIndices(unsigned int capacity)
+{
+    std::cout << "Growing geometry pool to " << capacity << " indices" << std::endl;
+
+    // Bind through the VAO, so it picks up the new element buffer
+    glBindVertexArray(_VAO);
+    _EBO = growBuffer(GL_ELEMENT_ARRAY_BUFFER, _EBO, (size_t)_indices.getCapacity() * sizeof(unsigned int), 
+                      (size_t)capacity * sizeof(unsigned int));
+    _indices.grow(capacity);
+    glBindVertexArray(0);
+}
@@ -0,0 +1,91 @@
+#ifndef __GEOMETRYPOOL__
+#define __GEOMETRYPOOL__
+
+#include "global.h"
+#include <map>
+
+#include "vertexFormat.h"
+
+/**
+ * @brief First-fit allocator over a range of [0, capacity) elements. Free ranges are
+ * kept sorted by offset and merged with their neighbours when released.
+ */
+class RangeAllocator
+{
+public:
+    RangeAllocator(unsigned int capacity = 0);
+
+    bool allocate(unsigned int size, unsigned int &offset);
+    void release(unsigned int offset, unsigned int size);
+    // Extends the range, making the new space free
+    void grow(unsigned int capacity);
+
+    unsigned int getCapacity() const { return _capacity; }
+    unsigned int getUsed() const { return _used; }
+    unsigned int getFreeRangeCount() const { return _free.size(); }
+
+private:
+    unsigned int _capacity;
+    unsigned int _used { 0 };
+    // offset -> size
+    std::map<unsigned int, unsigned int> _free;
+};
+
+/**
+ * @brief Where a mesh lives inside a GeometryPool.
+ */
+struct GeometryAllocation {
+    unsigned int baseVertex { 0 };
+    unsigned int vertexCount { 0 };
+    unsigned int firstIndex { 0 };
+    unsigned int indexCount { 0 };
+
+    bool valid() const { return vertexCount > 0; }
+};
+
+/**
+ * @brief Shared vertex and index buffers for all static meshes of one VertexFormat,
+ * under a single VAO.
+ *
+ * Meshes are sub-allocated from the buffers and drawn with glDrawElementsBaseVertex, so
+ * indices stay relative to the mesh. The buffers double in size (copied on the GPU)
+ * when they run out of space.
+ *
+ * Pools are destroyed in static teardown, after the GL context has gone, so their GL
+ * objects are deleted separately, by releaseAll(). Allocations can still be released after
+ * that - the ranges are only bookkeeping.
+ */
+class GeometryPool
+{
+public:
+    // The pool for a vertex format, created on first use
+    static GeometryPool& forFormat(const VertexFormat &format);
+    // Deletes every pool's VAO and buffers, once nothing will draw from them again
+    static void releaseAll();
+
+    GeometryPool(const VertexFormat &format);
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    /**
+     * @brief Copies packed vertices (in this pool's format) and indices into the pool.
+     */
+    GeometryAllocation allocate(const vector<unsigned char> &vertexData, const vector<unsigned int> &indices);
+    void release(GeometryAllocation &allocation);
+
+    void bind() const { glBindVertexArray(_VAO); }
+
+    const VertexFormat& getFormat() const { return _format; }
+    const RangeAllocator& getVertices() const { return _vertices; }
+    const RangeAllocator& getIndices() const { return _indices; }
+
+private:
+    VertexFormat _format;
+    unsigned int _VAO, _VBO, _EBO;
+    RangeAllocator _vertices, _indices;
+
+    void growVertices(unsigned int capacity);
+    void growIndices(unsigned int capacity);
+};
+
+#endif /* __GEOMETRYPOOL__ */
@@ -0,0 +1,59 @@
+#include "glExtensions.h"
+
+GLExtensions glExtensions;
+
+PFNGLGETPROGRAMBINARYPROC glext_glGetProgramBinary = nullptr;
+PFNGLPROGRAMBINARYPROC glext_glProgramBinary = nullptr;
+PFNGLPROGRAMPARAMETERIPROC glext_glProgramParameteri = nullptr;
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glext_glMaxShaderCompilerThreadsKHR = nullptr;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glext_glMultiDrawElementsIndirect = nullptr;
+PFNGLSHADERSTORAGEBLOCKBINDINGPROC glext_glShaderStorageBlockBinding = nullptr;
+PFNGLGETPROGRAMRESOURCEINDEXPROC glext_glGetProgramResourceIndex = nullptr;
+PFNGLDISPATCHCOMPUTEPROC glext_glDispatchCompute = nullptr;
+PFNGLMEMORYBARRIERPROC glext_glMemoryBarrier = nullptr;
+
+void loadGLExtensions() {
+    glExtensions.textureCompressionS3TC = glfwExtensionSupported("GL_EXT_texture_compression_s3tc");
+
+    if (glfwExtensionSupported("GL_ARB_get_program_binary")) {
+        glext_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)glfwGetProcAddress("glGetProgramBinary");
+        glext_glProgramBinary = (PFNGLPROGRAMBINARYPROC)glfwGetProcAddress("glProgramBinary");
+        glext_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)glfwGetProcAddress("glProgramParameteri");
+
+        int formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        glExtensions.getProgramBinary = formats > 0 && glext_glGetProgramBinary && glext_glProgramBinary && glext_glProgramParameteri;
+    }
+
+    if (glfwExtensionSupported("GL_KHR_parallel_shader_compile")) {
+        glext_glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+    } else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile")) {
+        glext_glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+    }
+    glExtensions.parallelShaderCompile = glext_glMaxShaderCompilerThreadsKHR != nullptr;
+    // As many compiler threads as the driver likes
+    if (glExtensions.parallelShaderCompile) glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+
+    if (glfwExtensionSupported("GL_ARB_multi_draw_indirect") && glfwExtensionSupported("GL_ARB_draw_indirect")
+        && glfwExtensionSupported("GL_ARB_shader_storage_buffer_object")
+        && glfwExtensionSupported("GL_ARB_program_interface_query")
+        && glfwExtensionSupported("GL_ARB_shader_draw_parameters")) {
+        glext_glMultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)glfwGetProcAddress("glMultiDrawElementsIndirect");
+        glext_glShaderStorageBlockBinding = (PFNGLSHADERSTORAGEBLOCKBINDINGPROC)glfwGetProcAddress("glShaderStorageBlockBinding");
+        glext_glGetProgramResourceIndex = (PFNGLGETPROGRAMRESOURCEINDEXPROC)glfwGetProcAddress("glGetProgramResourceIndex");
+        glExtensions.multiDrawIndirect = glext_glMultiDrawElementsIndirect && glext_glShaderStorageBlockBinding
+                                      && glext_glGetProgramResourceIndex;
+    }
+
+    if (glExtensions.multiDrawIndirect && glfwExtensionSupported("GL_ARB_compute_shader")) {
+        glext_glDispatchCompute = (PFNGLDISPATCHCOMPUTEPROC)glfwGetProcAddress("glDispatchCompute");
+        glext_glMemoryBarrier = (PFNGLMEMORYBARRIERPROC)glfwGetProcAddress("glMemoryBarrier");
+        glExtensions.computeShader = glext_glDispatchCompute && glext_glMemoryBarrier;
+    }
+
+    std::cout << "GL extensions: S3TC " << (glExtensions.textureCompressionS3TC ? "yes" : "no")
+              << ", program binaries " << (glExtensions.getProgramBinary ? "yes" : "no")
+              << ", parallel shader compile " << (glExtensions.parallelShaderCompile ? "yes" : "no")
+              << ", multi-draw indirect " << (glExtensions.multiDrawIndirect ? "yes" : "no")
+              << ", compute " << (glExtensions.computeShader ? "yes" : "no") << std::endl;
+}
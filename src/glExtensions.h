@@ -0,0 +1,88 @@
+#ifndef __GLEXTENSIONS__
+#define __GLEXTENSIONS__
+
+#include "global.h"
+
+/**
+ * @file glExtensions.h
+ * @brief Extensions used on top of the GL 3.3 core loader generated by glad.
+ *
+ * Everything here is optional - check the matching flag in `glExtensions` before use.
+ */
+
+// EXT_texture_compression_s3tc
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+// EXT_texture_sRGB, with S3TC
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+
+// ARB_get_program_binary
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+extern PFNGLGETPROGRAMBINARYPROC glext_glGetProgramBinary;
+extern PFNGLPROGRAMBINARYPROC glext_glProgramBinary;
+extern PFNGLPROGRAMPARAMETERIPROC glext_glProgramParameteri;
+#define glGetProgramBinary glext_glGetProgramBinary
+#define glProgramBinary glext_glProgramBinary
+#define glProgramParameteri glext_glProgramParameteri
+
+// KHR_parallel_shader_compile, or the equivalent ARB extension
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glext_glMaxShaderCompilerThreadsKHR;
+#define glMaxShaderCompilerThreadsKHR glext_glMaxShaderCompilerThreadsKHR
+
+// ARB_draw_indirect and ARB_multi_draw_indirect
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+extern PFNGLMULTIDRAWELEMENTSINDIRECTPROC glext_glMultiDrawElementsIndirect;
+#define glMultiDrawElementsIndirect glext_glMultiDrawElementsIndirect
+
+// ARB_shader_storage_buffer_object, with ARB_program_interface_query to find the blocks
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#define GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT 0x90DF
+#define GL_SHADER_STORAGE_BLOCK 0x92E6
+typedef void (APIENTRYP PFNGLSHADERSTORAGEBLOCKBINDINGPROC)(GLuint program, GLuint storageBlockIndex, GLuint storageBlockBinding);
+typedef GLuint (APIENTRYP PFNGLGETPROGRAMRESOURCEINDEXPROC)(GLuint program, GLenum programInterface, const GLchar *name);
+extern PFNGLSHADERSTORAGEBLOCKBINDINGPROC glext_glShaderStorageBlockBinding;
+extern PFNGLGETPROGRAMRESOURCEINDEXPROC glext_glGetProgramResourceIndex;
+#define glShaderStorageBlockBinding glext_glShaderStorageBlockBinding
+#define glGetProgramResourceIndex glext_glGetProgramResourceIndex
+
+// ARB_compute_shader, with glMemoryBarrier from ARB_shader_image_load_store
+#define GL_COMPUTE_SHADER 0x91B9
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint numGroupsX, GLuint numGroupsY, GLuint numGroupsZ);
+typedef void (APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+extern PFNGLDISPATCHCOMPUTEPROC glext_glDispatchCompute;
+extern PFNGLMEMORYBARRIERPROC glext_glMemoryBarrier;
+#define glDispatchCompute glext_glDispatchCompute
+#define glMemoryBarrier glext_glMemoryBarrier
+
+struct GLExtensions {
+    bool textureCompressionS3TC { false };
+    // Also requires the driver to offer at least one binary format
+    bool getProgramBinary { false };
+    bool parallelShaderCompile { false };
+    // Multi-draw indirect with storage buffers and gl_DrawIDARB (ARB_shader_draw_parameters)
+    bool multiDrawIndirect { false };
+    // Compute shaders writing storage buffers. Only set along with multiDrawIndirect.
+    bool computeShader { false };
+};
+
+extern GLExtensions glExtensions;
+
+/**
+ * @brief Queries available extensions and loads their entry points. Requires a current
+ * GL context.
+ */
+void loadGLExtensions();
+
+#endif /* __GLEXTENSIONS__ */
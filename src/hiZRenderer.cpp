@@ -0,0 +1,167 @@
+#include "hiZRenderer.h"
+
+#include <algorithm>
+#include <cstring>
+
+bool HiZBuffer::isVisible(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) const {
+    float nearest = INFINITY;
+    glm::vec2 screenMin(INFINITY), screenMax(-INFINITY);
+    for (int c = 0; c < 8; c++) {
+        glm::vec3 corner((c & 1) ? boundsMax.x : boundsMin.x, (c & 2) ? boundsMax.y : boundsMin.y,
+                         (c & 4) ? boundsMax.z : boundsMin.z);
+        glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+        // Clipped by the near plane, so the box test later would be unreliable too
+        if (clip.w <= 0.0f || clip.z < -clip.w) return true;
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        glm::vec2 screen((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height);
+        nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+        screenMin = glm::min(screenMin, screen);
+        screenMax = glm::max(screenMax, screen);
+    }
+
+    // Anything outside the old view is unknown
+    int minX = (int)std::floor(screenMin.x), maxX = (int)std::floor(screenMax.x);
+    int minY = (int)std::floor(screenMin.y), maxY = (int)std::floor(screenMax.y);
+    if (minX < 0 || minY < 0 || maxX >= width || maxY >= height) return true;
+
+    // Texels don't line up exactly with the screen when a level above had an odd size
+    minX = std::max(minX - 1, 0);
+    minY = std::max(minY - 1, 0);
+    maxX = std::min(maxX + 1, width - 1);
+    maxY = std::min(maxY + 1, height - 1);
+
+    for (int y = minY; y <= maxY; y++) {
+        const float *row = &depth[y * width];
+        for (int x = minX; x <= maxX; x++) {
+            if (nearest <= row[x]) return true;
+        }
+    }
+    return false;
+}
+
+glm::ivec2 HiZRenderer::levelSize(int level) const {
+    // Level 0 is half the depth buffer
+    return glm::max(_screenRes >> (level + 1), glm::ivec2(1));
+}
+
+void HiZRenderer::init(glm::ivec2 screenResolution) {
+    if (_init) return;
+
+    _screenRes = screenResolution;
+
+    _levelCount = 1;
+    while (levelSize(_levelCount - 1) != glm::ivec2(1)) _levelCount++;
+    _readbackLevel = 0;
+    while (levelSize(_readbackLevel).x > MAX_READBACK_WIDTH) _readbackLevel++;
+    _readbackSize = levelSize(_readbackLevel);
+
+    // Pyramid
+    glGenTextures(1, &_texture);
+    glBindTexture(GL_TEXTURE_2D, _texture);
+    for (int level = 0; level < _levelCount; level++) {
+        glm::ivec2 size = levelSize(level);
+        glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, size.x, size.y, 0, GL_RED, GL_FLOAT, NULL);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, _levelCount - 1);
+
+    glGenFramebuffers(1, &_FBO);
+
+    // Readback
+    glGenBuffers(2, _pixelBuffers);
+    for (int i = 0; i < 2; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, _pixelBuffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, _readbackSize.x * _readbackSize.y * sizeof(float), NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    _reducePass.init("hi-z reduce", "hiZReduce.fs", { "source" });
+    _reducePass.getShader();
+
+    _init = true;
+}
+
+void HiZRenderer::release() {
+    if (!_init) return;
+
+    glDeleteFramebuffers(1, &_FBO);
+    glDeleteTextures(1, &_texture);
+    glDeleteBuffers(2, _pixelBuffers);
+    for (GLsync &fence : _fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    _reducePass.release();
+    _init = false;
+}
+
+void HiZRenderer::build(unsigned int depthTexture, const glm::mat4 &viewProjection) {
+    _reducePass.begin(_FBO, {});
+
+    for (int level = 0; level < _levelCount; level++) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _texture, level);
+        glm::ivec2 size = levelSize(level);
+        glViewport(0, 0, size.x, size.y);
+
+        // Restrict sampling to the previous level, so reading and writing the same texture is defined
+        if (level == 0) {
+            _reducePass.setInput(0, depthTexture);
+        } else {
+            _reducePass.setInput(0, _texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+        }
+        _reducePass.draw();
+    }
+    _reducePass.end();
+    glBindTexture(GL_TEXTURE_2D, _texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, _levelCount - 1);
+
+    // Start reading back the coarse level, replacing a readback that was never collected
+    if (_fences[_next]) glDeleteSync(_fences[_next]);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _texture, _readbackLevel);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _pixelBuffers[_next]);
+    glReadPixels(0, 0, _readbackSize.x, _readbackSize.y, GL_RED, GL_FLOAT, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    _fences[_next] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _viewProjections[_next] = viewProjection;
+    _next = 1 - _next;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool HiZRenderer::collect(HiZBuffer &buffer) {
+    bool collected = false;
+
+    // Oldest first, so the newest finished readback wins
+    for (unsigned int i = 0; i < 2; i++) {
+        unsigned int slot = (_next + i) % 2;
+        if (!_fences[slot]) continue;
+
+        GLenum status = glClientWaitSync(_fences[slot], 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) continue;
+        glDeleteSync(_fences[slot]);
+        _fences[slot] = nullptr;
+
+        size_t size = _readbackSize.x * _readbackSize.y * sizeof(float);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, _pixelBuffers[slot]);
+        void *data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+        if (data) {
+            buffer.width = _readbackSize.x;
+            buffer.height = _readbackSize.y;
+            buffer.depth.resize(_readbackSize.x * _readbackSize.y);
+            memcpy(buffer.depth.data(), data, size);
+            buffer.viewProjection = _viewProjections[slot];
+            collected = true;
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    return collected;
+}
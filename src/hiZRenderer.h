@@ -0,0 +1,67 @@
+#ifndef __HIZRENDERER__
+#define __HIZRENDERER__
+
+#include "global.h"
+#include "fullscreenPass.h"
+
+/**
+ * @brief A CPU copy of one level of the depth pyramid, with the view it was rendered from.
+ */
+struct HiZBuffer {
+    int width { 0 }, height { 0 };
+    // Farthest window space depth under each texel, rows bottom to top
+    vector<float> depth;
+    glm::mat4 viewProjection;
+
+    bool valid() const { return !depth.empty(); }
+
+    /**
+     * @brief false if the box was certainly hidden in the view the buffer was rendered
+     * from. Boxes reaching outside that view, or in front of its near plane, are visible.
+     */
+    bool isVisible(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) const;
+};
+
+/**
+ * @brief Builds a hierarchical Z pyramid - each level holding the farthest depth of the
+ * level above - from a depth buffer, and reads a coarse level back to the CPU.
+ *
+ * Readbacks go through a pair of pixel buffers and are only collected once their fence
+ * has signalled, so the CPU never waits for the GPU. The buffer it gets is one or two
+ * frames old.
+ */
+class HiZRenderer {
+    // Widest level read back to the CPU
+    const int MAX_READBACK_WIDTH = 256;
+
+    bool _init { false };
+    glm::ivec2 _screenRes;
+    unsigned int _FBO, _texture;
+    int _levelCount { 0 };
+    int _readbackLevel { 0 };
+    glm::ivec2 _readbackSize;
+
+    unsigned int _pixelBuffers[2];
+    GLsync _fences[2] { nullptr, nullptr };
+    glm::mat4 _viewProjections[2];
+    unsigned int _next { 0 };
+
+    FullscreenPass _reducePass;
+
+    glm::ivec2 levelSize(int level) const;
+
+public:
+    HiZRenderer() {};
+    void init(glm::ivec2 screenResolution);
+    // Deletes the framebuffer, pyramid texture, readback buffers and fences, and the pass
+    void release();
+
+    // Builds the pyramid from a depth texture rendered with `viewProjection`, and starts reading it back
+    void build(unsigned int depthTexture, const glm::mat4 &viewProjection);
+    // Copies the newest finished readback into `buffer`. Returns false if none has finished.
+    bool collect(HiZBuffer &buffer);
+
+    unsigned int getTexture() const { return _texture; }
+};
+
+#endif /* __HIZRENDERER__ */
@@ -0,0 +1,111 @@
+#include "image.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stb_image.h>
+
+bool loadImage(const char *path, ImageRGBA &image, int *sourceChannels) {
+    // image coords are different to gl coords, so flip image
+    // Per thread, since images are loaded on worker threads
+    stbi_set_flip_vertically_on_load_thread(true);
+
+    int width, height, channels;
+    unsigned char *data = stbi_load(path, &width, &height, &channels, 4);
+    if (!data) return false;
+
+    image = ImageRGBA(width, height);
+    memcpy(image.pixels.data(), data, image.pixels.size());
+    stbi_image_free(data);
+
+    if (sourceChannels) *sourceChannels = channels;
+    return true;
+}
+
+namespace {
+
+// sRGB <-> linear lookup tables. Linear values are quantized to 12 bits on the way back.
+const int LINEAR_LEVELS = 4096;
+
+struct SRGBTables {
+    float toLinear[256];
+    unsigned char fromLinear[LINEAR_LEVELS];
+
+    SRGBTables() {
+        for (int i = 0; i < 256; i++) {
+            float c = i / 255.0f;
+            toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i < LINEAR_LEVELS; i++) {
+            float l = i / (float)(LINEAR_LEVELS - 1);
+            float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+            fromLinear[i] = (unsigned char)glm::clamp((int)(c * 255.0f + 0.5f), 0, 255);
+        }
+    }
+};
+
+const SRGBTables& srgbTables() {
+    static const SRGBTables tables;
+    return tables;
+}
+
+void downsampleTexel(const unsigned char *texels[4], unsigned char *out, MipFilter filter) {
+    // Alpha is never encoded
+    int alpha = texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3];
+    out[3] = (unsigned char)((alpha + 2) / 4);
+
+    switch (filter) {
+        case MipFilter::LINEAR:
+            for (int c = 0; c < 3; c++) {
+                int sum = texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c];
+                out[c] = (unsigned char)((sum + 2) / 4);
+            }
+            break;
+
+        case MipFilter::SRGB: {
+            const SRGBTables &tables = srgbTables();
+            for (int c = 0; c < 3; c++) {
+                float sum = tables.toLinear[texels[0][c]] + tables.toLinear[texels[1][c]]
+                          + tables.toLinear[texels[2][c]] + tables.toLinear[texels[3][c]];
+                out[c] = tables.fromLinear[(int)(sum * 0.25f * (LINEAR_LEVELS - 1) + 0.5f)];
+            }
+            break;
+        }
+
+        case MipFilter::NORMAL_MAP: {
+            glm::vec3 sum(0.0f);
+            for (int i = 0; i < 4; i++)
+                sum += glm::vec3(texels[i][0], texels[i][1], texels[i][2]) / 127.5f - 1.0f;
+            float length = glm::length(sum);
+            glm::vec3 normal = length > 0.0f ? sum / length : glm::vec3(0.0f, 0.0f, 1.0f);
+            for (int c = 0; c < 3; c++)
+                out[c] = (unsigned char)glm::clamp((int)((normal[c] + 1.0f) * 127.5f + 0.5f), 0, 255);
+            break;
+        }
+    }
+}
+
+}
+
+vector<ImageRGBA> generateMipChain(const ImageRGBA &image, MipFilter filter) {
+    vector<ImageRGBA> levels;
+    levels.push_back(image);
+
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        const ImageRGBA &src = levels.back();
+        ImageRGBA dst(std::max(src.width / 2, 1), std::max(src.height / 2, 1));
+
+        // 2x2 box filter, clamped at the edges for odd or 1-pixel dimensions
+        for (int y = 0; y < dst.height; y++) {
+            int y0 = std::min(y * 2, src.height - 1), y1 = std::min(y * 2 + 1, src.height - 1);
+            for (int x = 0; x < dst.width; x++) {
+                int x0 = std::min(x * 2, src.width - 1), x1 = std::min(x * 2 + 1, src.width - 1);
+                const unsigned char *texels[4] = { src.at(x0, y0), src.at(x1, y0), src.at(x0, y1), src.at(x1, y1) };
+                downsampleTexel(texels, dst.at(x, y), filter);
+            }
+        }
+
+        levels.push_back(std::move(dst));
+    }
+
+    return levels;
+}
@@ -0,0 +1,46 @@
+#ifndef __IMAGE__
+#define __IMAGE__
+
+#include "global.h"
+
+/**
+ * @brief An 8-bit per channel RGBA image in CPU memory, rows bottom to top as GL expects.
+ */
+struct ImageRGBA {
+    int width { 0 };
+    int height { 0 };
+    vector<unsigned char> pixels;
+
+    ImageRGBA() {}
+    ImageRGBA(int width, int height) : width(width), height(height), pixels((size_t)width * height * 4) {}
+
+    unsigned char* at(int x, int y) { return &pixels[((size_t)y * width + x) * 4]; }
+    const unsigned char* at(int x, int y) const { return &pixels[((size_t)y * width + x) * 4]; }
+};
+
+/**
+ * @brief How texels are combined when downsampling.
+ */
+enum class MipFilter {
+    // Plain average of the stored values
+    LINEAR,
+    // RGB is sRGB encoded - averaged in linear space so mips don't darken
+    SRGB,
+    // RGB is a unit vector in [0,1] - averaged then renormalized
+    NORMAL_MAP,
+};
+
+/**
+ * @brief Loads an image from disk as RGBA, flipped to match GL texture coordinates.
+ *
+ * @return false if the image could not be loaded.
+ */
+bool loadImage(const char *path, ImageRGBA &image, int *sourceChannels = nullptr);
+
+/**
+ * @brief Builds the full mip chain for an image, down to 1x1, with a 2x2 box filter.
+ * Level 0 is a copy of `image`. Alpha is always filtered linearly.
+ */
+vector<ImageRGBA> generateMipChain(const ImageRGBA &image, MipFilter filter = MipFilter::LINEAR);
+
+#endif /* __IMAGE__ */
@@ -0,0 +1,319 @@
+#include "indirectDraws.h"
+
+#include <algorithm>
+
+#include "glExtensions.h"
+#include "model.h"
+#include "uniformBlocks.h"
+
+namespace {
+
+// Laid out as glMultiDrawElementsIndirect reads it
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+}
+
+void IndirectDraws::init()
+{
+    // Grows to fit the scene
+    _ring.init(GL_SHADER_STORAGE_BUFFER, 256 * 1024);
+
+    _gpuCulling = glExtensions.computeShader;
+    if (_gpuCulling) _cullShader = Shader("cull.cs");
+}
+
+void IndirectDraws::release()
+{
+    _ring.release();
+    if (_gpuCulling) glDeleteProgram(_cullShader.ID);
+    _gpuCulling = false;
+}
+
+bool IndirectDraws::isVisible(const CullView &view, const glm::mat4 &world,
+                              const glm::vec3 &boundsMin, const glm::vec3 &boundsMax)
+{
+    // World space box around the bounds
+    glm::vec3 localCenter = (boundsMin + boundsMax) * 0.5f;
+    glm::vec3 localExtent = (boundsMax - boundsMin) * 0.5f;
+    glm::vec3 center = glm::vec3(world * glm::vec4(localCenter, 1.0f));
+    glm::vec3 extent = glm::abs(glm::vec3(world[0])) * localExtent.x + glm::abs(glm::vec3(world[1])) * localExtent.y
+                     + glm::abs(glm::vec3(world[2])) * localExtent.z;
+
+    bool visible = view.viewCount == 0;
+    for (unsigned int v = 0; v < view.viewCount && !visible; v++) {
+        // Clip planes from the rows of the matrix, tested against the box's projected radius
+        glm::mat4 rows = glm::transpose(view.viewProjections[v]);
+        const glm::vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+                                      rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2] };
+        visible = true;
+        for (const glm::vec4 &plane : planes) {
+            float radius = glm::dot(glm::abs(glm::vec3(plane)), extent);
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                visible = false;
+                break;
+            }
+        }
+    }
+    if (visible && view.maxDistance > 0.0f) {
+        glm::vec3 nearest = glm::clamp(view.origin, center - extent, center + extent);
+        visible = glm::distance(nearest, view.origin) <= view.maxDistance;
+    }
+    return visible;
+}
+
+void IndirectDraws::beginFrame(unsigned int drawCount, unsigned int passCount)
+{
+    // Each pass's commands, draws and bounds start aligned
+    size_t padding = passCount * 3 * _ring.align(1);
+    _ring.beginFrame(drawCount * (sizeof(DrawElementsIndirectCommand) + sizeof(DrawBlock) + sizeof(BoundsBlock)) + padding);
+    _passes.clear();
+    _drawCount = 0;
+    _batchCount = 0;
+    _culledCount = 0;
+}
+
+/**
+ * @brief The group for a material within a pass. Packed materials share a group when they
+ * need the same variant and sit in the same arrays; any other material is a group of its own.
+ */
+unsigned int IndirectDraws::groupFor(Pass &pass, const Material &material, bool normalMaps)
+{
+    auto found = _groupOf.find(&material);
+    if (found != _groupOf.end()) return found->second;
+
+    ShaderDefines defines = material.getDefines();
+    if (!normalMaps) defines.erase("NORMAL_MAP");
+    defines["MULTI_DRAW"] = "1";
+
+    unsigned int group = pass.groups.size();
+    if (material.isPacked()) {
+        for (unsigned int i = 0; i < pass.groups.size(); i++) {
+            const Material &other = *pass.groups[i].material;
+            bool sameArrays = other.isPacked();
+            for (int slot = 0; slot < Material::SLOT_COUNT && sameArrays; slot++)
+                sameArrays = other.getTexture(slot).array == material.getTexture(slot).array;
+            if (sameArrays && pass.groups[i].defines == defines) {
+                group = i;
+                break;
+            }
+        }
+    }
+    if (group == pass.groups.size()) pass.groups.push_back({ &material, defines });
+
+    _groupOf[&material] = group;
+    return group;
+}
+
+unsigned int IndirectDraws::record(const vector<DrawItem> &items, unsigned int begin, unsigned int end,
+                                   bool textured, bool normalMaps, const Filter &filter, const CullView *view)
+{
+    _passes.emplace_back();
+    Pass &pass = _passes.back();
+
+    // Every mesh draw, in batch order, keeping the pass's order within each batch
+    _pending.clear();
+    _groupOf.clear();
+    for (unsigned int i = begin; i < end; i++) {
+        const DrawItem &item = items[i];
+        if (filter && !filter(item)) continue;
+        for (const Mesh &mesh : item.model->getMeshes()) {
+            if (!mesh.getGeometry().valid()) continue;
+            unsigned int group = textured ? groupFor(pass, mesh.getMaterial(), normalMaps) : 0;
+            _pending.push_back({ mesh.getPool(), group, &item, &mesh });
+        }
+    }
+    std::stable_sort(_pending.begin(), _pending.end(), [](const PendingDraw &a, const PendingDraw &b) {
+        return a.pool != b.pool ? std::less<GeometryPool*>()(a.pool, b.pool) : a.group < b.group;
+    });
+    if (_pending.empty()) return _passes.size() - 1;
+
+    UploadAllocation commands = _ring.allocate(_pending.size() * sizeof(DrawElementsIndirectCommand));
+    UploadAllocation draws = _ring.allocate(_pending.size() * sizeof(DrawBlock));
+    // Only the GPU needs the bounds
+    const bool gpuCulled = view && _gpuCulling;
+    UploadAllocation bounds;
+    if (gpuCulled) bounds = _ring.allocate(_pending.size() * sizeof(BoundsBlock));
+    if (!commands.data || !draws.data || (gpuCulled && !bounds.data)) return _passes.size() - 1;
+    pass.commandOffset = commands.offset;
+    pass.drawOffset = draws.offset;
+    pass.boundsOffset = bounds.offset;
+    pass.drawCount = _pending.size();
+    pass.gpuCulled = gpuCulled;
+    if (view) pass.view = *view;
+    if (gpuCulled && _validate) pass.expected.resize(_pending.size());
+
+    for (unsigned int i = 0; i < _pending.size(); i++) {
+        const PendingDraw &pending = _pending[i];
+        const Mesh &mesh = *pending.mesh;
+        const GeometryAllocation &geometry = mesh.getGeometry();
+        const MeshLod &lod = mesh.getLod(std::min(pending.item->lod, mesh.getLodCount() - 1));
+
+        DrawElementsIndirectCommand &command = ((DrawElementsIndirectCommand*)commands.data)[i];
+        command.count = lod.indexCount;
+        command.instanceCount = 1;
+        command.firstIndex = geometry.firstIndex + lod.indexOffset;
+        command.baseVertex = geometry.baseVertex;
+        command.baseInstance = 0;
+
+        if (view) {
+            bool visible = !gpuCulled || _validate
+                ? isVisible(*view, pending.item->world, mesh.getBoundsMin(), mesh.getBoundsMax()) : true;
+            if (gpuCulled) {
+                BoundsBlock &block = ((BoundsBlock*)bounds.data)[i];
+                block.boundsMin = glm::vec4(mesh.getBoundsMin(), 0.0f);
+                block.boundsMax = glm::vec4(mesh.getBoundsMax(), 0.0f);
+                if (_validate) pass.expected[i] = visible;
+            } else {
+                command.instanceCount = visible ? 1 : 0;
+                if (!visible) _culledCount++;
+            }
+        }
+
+        DrawBlock &block = ((DrawBlock*)draws.data)[i];
+        block.world = pending.item->world;
+        for (int c = 0; c < 3; c++)
+            block.normal[c] = glm::vec4(pending.item->normal[c], 0.0f);
+        glm::vec3 offset, scale;
+        mesh.getPositionDecode(offset, scale);
+        block.offset = glm::vec4(offset, 0.0f);
+        block.scale = glm::vec4(scale, 0.0f);
+        const Material &material = mesh.getMaterial();
+        block.layers = glm::vec4(material.getTexture(Material::DIFFUSE_UNIT).layer,
+                                 material.getTexture(Material::SPECULAR_UNIT).layer,
+                                 material.getTexture(Material::NORMAL_UNIT).layer, 0.0f);
+
+        if (i == 0 || pending.pool != _pending[i - 1].pool || pending.group != _pending[i - 1].group)
+            pass.batches.push_back({ pending.pool, pending.group, i, 0 });
+        pass.batches.back().count++;
+    }
+
+    _drawCount += pass.drawCount;
+    _batchCount += pass.batches.size();
+    return _passes.size() - 1;
+}
+
+void IndirectDraws::unmap()
+{
+    _ring.unmap();
+}
+
+/**
+ * @brief One invocation per draw, writing its command's instance count in place. Draws
+ * keep their slots, so batches and DrawBlock indices are unchanged.
+ */
+void IndirectDraws::cull()
+{
+    bool culled = false;
+    for (const Pass &pass : _passes) {
+        if (!pass.gpuCulled || pass.drawCount == 0) continue;
+        if (!culled) _cullShader.use();
+        culled = true;
+
+        unsigned int buffer = _ring.getBuffer();
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, COMMAND_BLOCK, buffer, pass.commandOffset,
+                          pass.drawCount * sizeof(DrawElementsIndirectCommand));
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, DRAW_BLOCK, buffer, pass.drawOffset, pass.drawCount * sizeof(DrawBlock));
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, BOUNDS_BLOCK, buffer, pass.boundsOffset, pass.drawCount * sizeof(BoundsBlock));
+
+        _cullShader.setInt("drawCount", pass.drawCount);
+        _cullShader.setInt("viewCount", pass.view.viewCount);
+        for (unsigned int i = 0; i < pass.view.viewCount; i++)
+            _cullShader.setMat4("viewProjections[" + std::to_string(i) + "]", pass.view.viewProjections[i]);
+        _cullShader.setVec3("origin", pass.view.origin);
+        _cullShader.setFloat("maxDistance", pass.view.maxDistance);
+
+        glDispatchCompute((pass.drawCount + 63) / 64, 1, 1);
+    }
+    if (!culled) return;
+
+    // Commands are read by the draws, and by the validation read back
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | (_validate ? GL_BUFFER_UPDATE_BARRIER_BIT : 0));
+    if (_validate) validate();
+}
+
+/**
+ * @brief Reads the culled commands back, waiting for the GPU, and compares them with
+ * isVisible().
+ */
+void IndirectDraws::validate()
+{
+    unsigned int mismatches = 0, total = 0;
+    vector<DrawElementsIndirectCommand> commands;
+    glBindBuffer(GL_COPY_READ_BUFFER, _ring.getBuffer());
+    for (const Pass &pass : _passes) {
+        if (!pass.gpuCulled || pass.expected.size() != pass.drawCount) continue;
+
+        commands.resize(pass.drawCount);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, pass.commandOffset, pass.drawCount * sizeof(DrawElementsIndirectCommand),
+                           commands.data());
+        for (unsigned int i = 0; i < pass.drawCount; i++) {
+            bool visible = commands[i].instanceCount != 0;
+            if (visible != (bool)pass.expected[i]) mismatches++;
+            if (!visible) _culledCount++;
+        }
+        total += pass.drawCount;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    _mismatches += mismatches;
+    if (mismatches > 0) {
+        std::cout << "ERROR::INDIRECTDRAWS::CULLING_MISMATCH " << mismatches << " of " << total
+                  << " draws differ from the CPU reference" << std::endl;
+    }
+}
+
+void IndirectDraws::bindPass(const Pass &pass) const
+{
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, DRAW_BLOCK, _ring.getBuffer(), pass.drawOffset,
+                      pass.drawCount * sizeof(DrawBlock));
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _ring.getBuffer());
+}
+
+void IndirectDraws::submit(const Pass &pass, const Batch &batch, int drawOffsetLocation) const
+{
+    batch.pool->bind();
+    glUniform1i(drawOffsetLocation, batch.first);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                (void*)(pass.commandOffset + batch.first * sizeof(DrawElementsIndirectCommand)),
+                                batch.count, 0);
+}
+
+void IndirectDraws::draw(unsigned int index, const Shader &shader)
+{
+    const Pass &pass = _passes[index];
+    if (pass.batches.empty()) return;
+
+    bindPass(pass);
+    const MeshProgramBindings &bindings = MeshProgramBindings::of(shader);
+    for (const Batch &batch : pass.batches)
+        submit(pass, batch, bindings.drawOffset);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void IndirectDraws::draw(unsigned int index, ShaderVariants &variants)
+{
+    const Pass &pass = _passes[index];
+    if (pass.batches.empty()) return;
+
+    bindPass(pass);
+    for (const Batch &batch : pass.batches) {
+        const Group &group = pass.groups[batch.group];
+        Shader &shader = variants.get(group.defines);
+        shader.use();
+        const MeshProgramBindings &bindings = MeshProgramBindings::of(shader);
+        group.material->bind(bindings);
+        submit(pass, batch, bindings.drawOffset);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void IndirectDraws::endFrame()
+{
+    _ring.endFrame();
+}
@@ -0,0 +1,155 @@
+#ifndef __INDIRECTDRAWS__
+#define __INDIRECTDRAWS__
+
+#include "global.h"
+#include <functional>
+#include <unordered_map>
+
+#include "renderPacket.h"
+#include "shaderVariants.h"
+#include "uploadRing.h"
+
+class GeometryPool;
+class Mesh;
+class Material;
+
+/**
+ * @brief What a pass can see, for culling its draws mesh by mesh.
+ */
+struct CullView {
+    // A mesh is kept if its bounds touch any of these frusta - the camera, the light, or
+    // each face of a point light
+    glm::mat4 viewProjections[6];
+    unsigned int viewCount { 0 };
+    // Meshes further than this from `origin` are culled, unless it is 0
+    glm::vec3 origin { 0.0f };
+    float maxDistance { 0.0f };
+};
+
+/**
+ * @brief Submits whole passes with glMultiDrawElementsIndirect, where the driver supports
+ * it (glExtensions.multiDrawIndirect).
+ *
+ * Every mesh of every item becomes an indirect command and a DrawBlock, both streamed
+ * through an upload ring. Draws are grouped into batches that can share one call: the
+ * same GeometryPool, since each pool has its own buffers and VAO, and in textured passes
+ * the same shader variant and textures - materials packed into the same texture arrays,
+ * or else one material. Programs built with MULTI_DRAW read their draw's DrawBlock from
+ * the Draws storage block, indexed by gl_DrawIDARB.
+ *
+ * Passes recorded with a CullView also cull each mesh's bounds against it. Where compute
+ * shaders are available that runs on the GPU, in cull(), which zeroes the instance count of
+ * hidden meshes' commands, so the CPU cost doesn't depend on what is visible. Otherwise the
+ * same test runs on the CPU while recording. isVisible() is the reference for both, and
+ * setValidation() compares the GPU's results against it.
+ *
+ * Usage per frame: beginFrame() with an upper bound on the draws, record() each pass,
+ * unmap(), cull(), draw() the passes, then endFrame() once they are submitted.
+ */
+class IndirectDraws
+{
+public:
+    using Filter = std::function<bool(const DrawItem&)>;
+
+    IndirectDraws() {}
+    IndirectDraws(const IndirectDraws&) = delete;
+    IndirectDraws& operator=(const IndirectDraws&) = delete;
+
+    void init();
+    // Deletes the ring and the cull program
+    void release();
+
+    // `drawCount` mesh draws over at most `passCount` passes
+    void beginFrame(unsigned int drawCount, unsigned int passCount);
+    /**
+     * @brief Writes the meshes of items [begin, end) for which `filter` holds, or all of
+     * them without a filter. Textured passes are batched by material, with variants that
+     * sample normal maps if `normalMaps` is set.
+     *
+     * @return The pass, for draw().
+     */
+    unsigned int record(const vector<DrawItem> &items, unsigned int begin, unsigned int end,
+                        bool textured, bool normalMaps = true, const Filter &filter = nullptr,
+                        const CullView *view = nullptr);
+    void unmap();
+    // Culls the passes recorded with a view on the GPU, if it is culling them
+    void cull();
+    // Draws an untextured pass. `shader` must be built with MULTI_DRAW and in use.
+    void draw(unsigned int pass, const Shader &shader);
+    // Draws a textured pass, each batch with its MULTI_DRAW variant
+    void draw(unsigned int pass, ShaderVariants &variants);
+    void endFrame();
+
+    // For the frame last recorded
+    unsigned int getDrawCount() const { return _drawCount; }
+    unsigned int getBatchCount() const { return _batchCount; }
+    // Draws culled, if known - always on the CPU path, only while validating on the GPU
+    unsigned int getCulledCount() const { return _culledCount; }
+
+    bool getGPUCulling() const { return _gpuCulling; }
+    // Reads the GPU's culling back every frame and reports where it differs from isVisible()
+    void setValidation(bool val) { _validate = val; }
+    unsigned int getValidationMismatches() const { return _mismatches; }
+
+    // Whether a mesh with bounds [boundsMin, boundsMax] in its object's space, placed by
+    // `world`, can be seen from `view`
+    static bool isVisible(const CullView &view, const glm::mat4 &world,
+                          const glm::vec3 &boundsMin, const glm::vec3 &boundsMax);
+
+private:
+    // Draws with the same program and textures
+    struct Group {
+        const Material *material;
+        ShaderDefines defines;
+    };
+
+    struct Batch {
+        GeometryPool *pool;
+        unsigned int group;
+        // Draws, relative to the pass
+        unsigned int first;
+        unsigned int count;
+    };
+
+    struct Pass {
+        size_t commandOffset { 0 };
+        size_t drawOffset { 0 };
+        size_t boundsOffset { 0 };
+        unsigned int drawCount { 0 };
+        // Culled on the GPU by `view`, with what isVisible() expects when validating
+        bool gpuCulled { false };
+        CullView view;
+        vector<uint8_t> expected;
+        vector<Batch> batches;
+        vector<Group> groups;
+    };
+
+    struct PendingDraw {
+        GeometryPool *pool;
+        unsigned int group;
+        const DrawItem *item;
+        const Mesh *mesh;
+    };
+
+    UploadRing _ring;
+    vector<Pass> _passes;
+    unsigned int _drawCount { 0 };
+    unsigned int _batchCount { 0 };
+    unsigned int _culledCount { 0 };
+
+    bool _gpuCulling { false };
+    Shader _cullShader;
+    bool _validate { false };
+    unsigned int _mismatches { 0 };
+
+    // Scratch for record()
+    vector<PendingDraw> _pending;
+    std::unordered_map<const Material*, unsigned int> _groupOf;
+
+    unsigned int groupFor(Pass &pass, const Material &material, bool normalMaps);
+    void validate();
+    void bindPass(const Pass &pass) const;
+    void submit(const Pass &pass, const Batch &batch, int drawOffsetLocation) const;
+};
+
+#endif /* __INDIRECTDRAWS__ */
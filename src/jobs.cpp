@@ -0,0 +1,157 @@
+#include "jobs.h"
+
+#include <algorithm>
+
+namespace {
+
+// The pool the current thread works for, and its queue
+thread_local JobSystem *currentSystem = nullptr;
+thread_local unsigned int currentQueue = 0;
+
+}
+
+JobSystem& JobSystem::instance()
+{
+    static JobSystem system(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+    return system;
+}
+
+JobSystem::JobSystem(unsigned int workerCount)
+{
+    workerCount = std::max(workerCount, 1u);
+    for (unsigned int i = 0; i <= workerCount; i++)
+        _queues.push_back(std::make_unique<WorkQueue>());
+    for (unsigned int i = 0; i < workerCount; i++)
+        _workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    // Workers drain the queues before leaving
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _quit = true;
+    }
+    _wake.notify_all();
+    for (std::thread &worker : _workers)
+        worker.join();
+}
+
+void JobSystem::run(Work work, JobCounter *counter, JobCounter *dependency)
+{
+    if (counter) counter->_count.fetch_add(1, std::memory_order_relaxed);
+
+    if (dependency) {
+        std::lock_guard<std::mutex> lock(dependency->_mutex);
+        if (dependency->_count.load(std::memory_order_acquire) > 0) {
+            dependency->_continuations.push_back({ std::move(work), counter });
+            return;
+        }
+    }
+    push({ std::move(work), counter });
+}
+
+void JobSystem::wait(JobCounter &counter)
+{
+    unsigned int queue = currentSystem == this ? currentQueue : _workers.size();
+    while (!counter.done()) {
+        if (!tryRunOne(queue)) std::this_thread::yield();
+    }
+    // The last job may still be releasing the counter
+    std::lock_guard<std::mutex> lock(counter._mutex);
+}
+
+void JobSystem::parallelFor(unsigned int count, unsigned int grain, const RangeWork &work)
+{
+    if (count == 0) return;
+    grain = std::max(grain, 1u);
+
+    // Queue all but the first range, which this thread runs itself
+    JobCounter counter;
+    for (unsigned int begin = grain; begin < count; begin += grain) {
+        unsigned int end = std::min(begin + grain, count);
+        run([&work, begin, end] { work(begin, end); }, &counter);
+    }
+    work(0, std::min(grain, count));
+    wait(counter);
+}
+
+void JobSystem::push(Job job)
+{
+    unsigned int queue = currentSystem == this ? currentQueue : _workers.size();
+    {
+        std::lock_guard<std::mutex> lock(_queues[queue]->mutex);
+        _queues[queue]->jobs.push_back(std::move(job));
+    }
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _queued.fetch_add(1, std::memory_order_relaxed);
+    }
+    _wake.notify_one();
+}
+
+/**
+ * @brief Runs one job, newest first from the thread's own queue, otherwise oldest first
+ * from any other queue.
+ *
+ * @return false if there was nothing to run.
+ */
+bool JobSystem::tryRunOne(unsigned int queueIndex)
+{
+    Job job;
+    bool found = false;
+
+    // Starting from the next queue along, so thieves spread over the pool
+    const unsigned int queueCount = _queues.size();
+    for (unsigned int i = 0; i < queueCount && !found; i++) {
+        unsigned int index = (queueIndex + i) % queueCount;
+        WorkQueue &queue = *_queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty()) continue;
+
+        bool own = index == queueIndex && index != _workers.size();
+        if (own) {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        } else {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+        found = true;
+    }
+
+    if (!found) return false;
+    _queued.fetch_sub(1, std::memory_order_relaxed);
+    execute(job);
+    return true;
+}
+
+void JobSystem::execute(Job &job)
+{
+    job.work();
+    if (!job.counter) return;
+
+    // Decremented under the lock, so wait() can't return while this still holds it
+    std::vector<JobCounter::Continuation> ready;
+    {
+        std::lock_guard<std::mutex> lock(job.counter->_mutex);
+        if (job.counter->_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            ready.swap(job.counter->_continuations);
+    }
+    for (JobCounter::Continuation &continuation : ready)
+        push({ std::move(continuation.work), continuation.counter });
+}
+
+void JobSystem::workerLoop(unsigned int index)
+{
+    currentSystem = this;
+    currentQueue = index;
+
+    while (true) {
+        if (tryRunOne(index)) continue;
+
+        std::unique_lock<std::mutex> lock(_sleepMutex);
+        _wake.wait(lock, [this] { return _queued.load(std::memory_order_relaxed) > 0 || _quit; });
+        if (_quit && _queued.load(std::memory_order_relaxed) == 0) return;
+    }
+}
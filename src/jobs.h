@@ -0,0 +1,120 @@
+#ifndef __JOBS__
+#define __JOBS__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @file jobs.h
+ * @brief A pool of worker threads, one per core, shared by everything that runs work in
+ * the background - texture decoding, mesh simplification and frame preparation.
+ *
+ * Each worker owns a deque: it pushes and pops its own jobs at the back, and idle workers
+ * steal from the front of the others. Threads outside the pool submit to a shared queue.
+ * Any thread waiting on a counter runs jobs until the counter reaches zero instead of
+ * blocking, so waiting from inside a job can't deadlock the pool.
+ *
+ * Doesn't depend on GL, so it builds as its own library.
+ */
+
+class JobSystem;
+
+/**
+ * @brief Counts the unfinished jobs it was passed to. Also holds jobs which depend on it,
+ * which are queued once it reaches zero.
+ *
+ * A counter must outlive the jobs counting against it and any jobs depending on it.
+ */
+class JobCounter
+{
+public:
+    JobCounter() {}
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool done() const { return _count.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    struct Continuation {
+        std::function<void()> work;
+        JobCounter *counter;
+    };
+
+    std::atomic<int> _count { 0 };
+    std::mutex _mutex;
+    std::vector<Continuation> _continuations;
+};
+
+class JobSystem
+{
+public:
+    using Work = std::function<void()>;
+    using RangeWork = std::function<void(unsigned int begin, unsigned int end)>;
+
+    /**
+     * @brief The shared pool, started on first use with one worker per core less one,
+     * leaving a core for the thread that waits.
+     */
+    static JobSystem& instance();
+
+    explicit JobSystem(unsigned int workerCount);
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    /**
+     * @brief Queues a job. `counter` is incremented now and decremented once the job has
+     * run. If `dependency` is given, the job isn't queued until it reaches zero.
+     */
+    void run(Work work, JobCounter *counter = nullptr, JobCounter *dependency = nullptr);
+
+    /**
+     * @brief Runs other jobs until `counter` reaches zero.
+     */
+    void wait(JobCounter &counter);
+
+    /**
+     * @brief Calls `work` over [0, count) in ranges of at most `grain` items, spread over
+     * the pool, and returns once they have all run. The calling thread takes part.
+     */
+    void parallelFor(unsigned int count, unsigned int grain, const RangeWork &work);
+
+    unsigned int getWorkerCount() const { return _workers.size(); }
+
+private:
+    struct Job {
+        Work work;
+        JobCounter *counter;
+    };
+
+    // Lock based - jobs are coarse enough that contention on these is negligible
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::thread> _workers;
+    // One per worker, then the shared queue for outside threads
+    std::vector<std::unique_ptr<WorkQueue>> _queues;
+
+    // Sleeping workers are woken through this when work is queued
+    std::mutex _sleepMutex;
+    std::condition_variable _wake;
+    std::atomic<int> _queued { 0 };
+    bool _quit { false };
+
+    void push(Job job);
+    bool tryRunOne(unsigned int queueIndex);
+    void execute(Job &job);
+    void workerLoop(unsigned int index);
+};
+
+#endif /* __JOBS__ */
@@ -55,17 +55,18 @@ int main()
     Renderer *renderer = Renderer::createRenderer(1200, 900);
 
     // Setup scene
-    auto backpack = shared_ptr<GameObject>(new GameObject("../res/backpack/backpack.obj"));
-    renderer->objects.push_back(backpack);
-    // backpack->scale = glm::vec3(1.0f);
-    // backpack->position = glm::vec3(0.0f, 0.0f, 5.0f);
+    // Mesh::validateQuantization = true;
+    auto backpack = shared_ptr<GameObject>(new GameObject("../res/backpack/backpack.obj", VertexFormat::compact(), 3));
+    renderer->addObject(backpack);
+    // backpack->setScale(glm::vec3(1.0f));
+    // backpack->setPosition(glm::vec3(0.0f, 0.0f, 5.0f));
 
     // Plane
-    Texture pixel("../res/brickwall.jpg", GL_RGB, true);
+    Texture pixel("../res/brickwall.jpg", true);
     pixel.type = "texturesDiffuse";
-    Texture pixelSpec("../res/pixel.png", GL_RGB, false);
+    Texture pixelSpec("../res/pixel.png", false);
     pixelSpec.type = "texturesSpecular";
-    Texture pixelNorm("../res/brickwall_normal.jpg", GL_RGB, false);
+    Texture pixelNorm("../res/brickwall_normal.jpg", false, true);
     pixelNorm.type = "textureNormal";
 
     std::vector<Vertex> planeVerts = {
@@ -79,14 +80,13 @@ int main()
         pixel, pixelSpec, pixelNorm
     };
 
-    Mesh plane(planeVerts, planeIndices, planeTextures);
-    plane.shininess = 128.0f;
+    Mesh plane(planeVerts, planeIndices, std::make_shared<Material>(planeTextures, 128.0f));
     auto planeModel = Model(plane); 
     auto planeObj = shared_ptr<GameObject>(new GameObject(planeModel));
-    renderer->objects.push_back(planeObj);
-    planeObj->scale = glm::vec3(10.0f);
-    planeObj->position = glm::vec3(0.0f, -1.7f, 0.0f);
-    planeObj->rotation = glm::vec3(3.14159265f * -0.5f, 0.0f, 0.0f);
+    renderer->addObject(planeObj);
+    planeObj->setScale(glm::vec3(10.0f));
+    planeObj->setPosition(glm::vec3(0.0f, -1.7f, 0.0f));
+    planeObj->setRotation(glm::vec3(3.14159265f * -0.5f, 0.0f, 0.0f));
 
     // Lights
     auto dirLight = shared_ptr<DirectionalLight>(new DirectionalLight(
@@ -112,20 +112,23 @@ int main()
     ));
 
     auto cubeObj = std::shared_ptr<Cube>(new Cube());
-    cubeObj->castsShadow = false;
-    cubeObj->scale = glm::vec3(0.2f);
-    cubeObj->position = glm::vec3(0.0f, 1.0f, -5.0f);
+    cubeObj->setCastsShadow(false);
+    cubeObj->setScale(glm::vec3(0.2f));
+    cubeObj->setPosition(glm::vec3(0.0f, 1.0f, -5.0f));
 
     auto cubeObj2 = std::shared_ptr<Cube>(new Cube());
-    cubeObj2->castsShadow = false;
-    cubeObj2->scale = glm::vec3(0.2f);
-    cubeObj2->position = glm::vec3(0.0f, 1.0f, 5.0f);
+    cubeObj2->setCastsShadow(false);
+    cubeObj2->setScale(glm::vec3(0.2f));
+    cubeObj2->setPosition(glm::vec3(0.0f, 1.0f, 5.0f));
 
     // Add objects
     renderer->pointLights.push_back(light2);
     renderer->pointLights.push_back(light1);
-    renderer->objects.push_back(cubeObj);
-    renderer->objects.push_back(cubeObj2);
+    renderer->addObject(cubeObj);
+    renderer->addObject(cubeObj2);
+
+    // Share texture bindings between the materials in the G-buffer pass
+    renderer->packMaterialTextures();
 
     // renderer->setSkyboxColor(vec3(0.02f, 0.1f, 0.3f));
     renderer->setSkyboxColor(vec3(0.0f, 0.005f, 0.01f));
@@ -157,8 +160,8 @@ int main()
         // renderer->dirLight->direction = glm::vec3(1.0f, -0.75f + 0.5f * sin(elapsedTime), -1.0f);
         light1->position = glm::vec3(5.0f * cos(1.0f * elapsedTime), 2.0f, 5.0f * sin(1.0f * elapsedTime));
         light2->position = glm::vec3(5.0f * cos(1.0f * elapsedTime), 2.0f, -5.0f * sin(1.0f * elapsedTime));
-        cubeObj->position = glm::vec3(5.0f * cos(1.0f * elapsedTime), 2.0f, 5.0f * sin(1.0f * elapsedTime));
-        cubeObj2->position = glm::vec3(5.0f * cos(1.0f * elapsedTime), 2.0f, -5.0f * sin(1.0f * elapsedTime));
+        cubeObj->setPosition(glm::vec3(5.0f * cos(1.0f * elapsedTime), 2.0f, 5.0f * sin(1.0f * elapsedTime)));
+        cubeObj2->setPosition(glm::vec3(5.0f * cos(1.0f * elapsedTime), 2.0f, -5.0f * sin(1.0f * elapsedTime)));
 
         processInput(renderer->getWindow(), renderer->camera, deltaTime);
 
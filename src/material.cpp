@@ -0,0 +1,121 @@
+#include "material.h"
+
+#include <atomic>
+#include <unordered_map>
+
+namespace {
+
+std::atomic<uint32_t> nextSortKey { 0 };
+// Arrays bound to each slot's unit by the last packed material drawn
+unsigned int boundArrays[Material::SLOT_COUNT] = {};
+
+}
+
+const MeshProgramBindings& MeshProgramBindings::of(const Shader &shader)
+{
+    static std::unordered_map<unsigned int, MeshProgramBindings> programs;
+    // Consecutive draws nearly always use the same program
+    static unsigned int lastProgram = 0;
+    static const MeshProgramBindings *last = nullptr;
+    if (last && lastProgram == shader.ID) return *last;
+
+    auto found = programs.find(shader.ID);
+    if (found == programs.end()) {
+        MeshProgramBindings bindings;
+        bindings.positionOffset = glGetUniformLocation(shader.ID, "positionOffset");
+        bindings.positionScale = glGetUniformLocation(shader.ID, "positionScale");
+        bindings.shininess = glGetUniformLocation(shader.ID, "material.shininess");
+        bindings.drawOffset = glGetUniformLocation(shader.ID, "drawOffset");
+
+        // Samplers keep their units, so they are only set here
+        const std::pair<const char*, int> samplers[] = {
+            { "material.texturesDiffuse[0]", Material::DIFFUSE_UNIT },
+            { "material.texturesSpecular[0]", Material::SPECULAR_UNIT },
+            { "material.textureNormal", Material::NORMAL_UNIT },
+        };
+        for (const auto &sampler : samplers) {
+            int location = glGetUniformLocation(shader.ID, sampler.first);
+            if (location == -1) continue;
+            glUniform1i(location, sampler.second);
+            bindings.textured = true;
+        }
+        const std::pair<const char*, int> arraySamplers[] = {
+            { "diffuseArray", Material::DIFFUSE_UNIT },
+            { "specularArray", Material::SPECULAR_UNIT },
+            { "normalArray", Material::NORMAL_UNIT },
+        };
+        for (const auto &sampler : arraySamplers) {
+            int location = glGetUniformLocation(shader.ID, sampler.first);
+            if (location == -1) continue;
+            glUniform1i(location, sampler.second);
+            bindings.textureArrays = true;
+        }
+        found = programs.emplace(shader.ID, bindings).first;
+    }
+
+    lastProgram = shader.ID;
+    last = &found->second;
+    return *last;
+}
+
+Material::Material()
+: _sortKey(nextSortKey++) {}
+
+Material::Material(const vector<Texture> &textures, float shininess)
+: _shininess(shininess), _sortKey(nextSortKey++)
+{
+    const std::pair<const char*, int> slots[] = {
+        { "texturesDiffuse", DIFFUSE_UNIT },
+        { "texturesSpecular", SPECULAR_UNIT },
+        { "textureNormal", NORMAL_UNIT },
+    };
+    for (const Texture &texture : textures) {
+        for (const auto &slot : slots) {
+            MaterialTexture &target = _textures[slot.second];
+            if (texture.type != slot.first || target.texture) continue;
+            target.texture = texture.ID;
+            target.imagePath = texture.imagePath;
+            target.gammaCorrect = texture.gammaCorrect;
+            target.normalMap = texture.normalMap;
+        }
+    }
+    if (_textures[NORMAL_UNIT].texture) _defines["NORMAL_MAP"] = "1";
+}
+
+void Material::setArrayLayers(const unsigned int arrays[SLOT_COUNT], const unsigned int layers[SLOT_COUNT])
+{
+    for (int i = 0; i < SLOT_COUNT; i++) {
+        _textures[i].array = arrays[i];
+        _textures[i].layer = layers[i];
+    }
+    _packed = true;
+    _defines["TEXTURE_ARRAYS"] = "1";
+}
+
+void Material::resetArrayBindings()
+{
+    for (unsigned int &array : boundArrays) array = 0;
+}
+
+void Material::bind(const MeshProgramBindings &bindings) const
+{
+    if (bindings.textureArrays && _packed) {
+        for (int i = 0; i < SLOT_COUNT; i++) {
+            if (boundArrays[i] == _textures[i].array) continue;
+            glActiveTexture(GL_TEXTURE0 + i);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, _textures[i].array);
+            boundArrays[i] = _textures[i].array;
+        }
+        glActiveTexture(GL_TEXTURE0);
+        // Not part of the VAO, so it holds for every draw until the next material
+        glVertexAttrib3f(LAYER_ATTRIBUTE, _textures[DIFFUSE_UNIT].layer, _textures[SPECULAR_UNIT].layer,
+                         _textures[NORMAL_UNIT].layer);
+    } else if (bindings.textured) {
+        for (int i = 0; i < SLOT_COUNT; i++) {
+            glActiveTexture(GL_TEXTURE0 + i);
+            glBindTexture(GL_TEXTURE_2D, _textures[i].texture);
+        }
+        glActiveTexture(GL_TEXTURE0);
+    }
+    if (bindings.shininess != -1) glUniform1f(bindings.shininess, _shininess);
+}
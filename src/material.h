@@ -0,0 +1,98 @@
+#ifndef __MATERIAL__
+#define __MATERIAL__
+
+#include "global.h"
+#include <cstdint>
+
+#include "shader.h"
+#include "texture.h"
+
+/**
+ * @brief Uniform locations a program needs to draw meshes, looked up the first time it
+ * draws one. -1 where the program doesn't use the uniform.
+ */
+struct MeshProgramBindings {
+    int positionOffset { -1 };
+    int positionScale { -1 };
+    int shininess { -1 };
+    // First draw of a multi-draw batch, in MULTI_DRAW programs
+    int drawOffset { -1 };
+    // Whether the program samples any material texture
+    bool textured { false };
+    // Whether it samples them from texture arrays instead - the TEXTURE_ARRAYS variant
+    bool textureArrays { false };
+
+    /**
+     * @brief The bindings for `shader`, which must be in use. On first use this also
+     * points the program's material samplers at Material's texture units.
+     */
+    static const MeshProgramBindings& of(const Shader &shader);
+};
+
+/**
+ * @brief One of a material's textures, with where it came from and, once packed, the
+ * array layer holding a copy of it.
+ */
+struct MaterialTexture {
+    unsigned int texture { 0 };
+    string imagePath;
+    bool gammaCorrect { false };
+    bool normalMap { false };
+    unsigned int array { 0 };
+    unsigned int layer { 0 };
+};
+
+/**
+ * @brief How a mesh's surface looks, resolved once at load time: a texture per slot, its
+ * shininess and the shader features it needs.
+ *
+ * Each slot has a fixed texture unit, so binding a material is three texture binds and a
+ * uniform. Meshes with the same material should share one instance.
+ *
+ * Once its textures are packed into arrays (see TextureArrays), programs with the
+ * TEXTURE_ARRAYS path sample those instead. Arrays are only rebound when they change, and
+ * the layers go in a vertex attribute constant, so materials packed into the same arrays
+ * draw one after another without any texture binds.
+ */
+class Material
+{
+public:
+    // Slots, which are also their texture units
+    static const int DIFFUSE_UNIT = 0;
+    static const int SPECULAR_UNIT = 1;
+    static const int NORMAL_UNIT = 2;
+    static const int SLOT_COUNT = 3;
+    // Vertex attribute holding the array layer of each slot
+    static const int LAYER_ATTRIBUTE = 4;
+
+    // Untextured
+    Material();
+    // The first texture of each type - texturesDiffuse, texturesSpecular and textureNormal
+    Material(const vector<Texture> &textures, float shininess);
+
+    void bind(const MeshProgramBindings &bindings) const;
+
+    const MaterialTexture& getTexture(int slot) const { return _textures[slot]; }
+    /**
+     * @brief Points the material at copies of its textures in arrays, one per slot (0 for
+     * empty slots), and enables TEXTURE_ARRAYS. The arrays must outlive the material's use.
+     */
+    void setArrayLayers(const unsigned int arrays[SLOT_COUNT], const unsigned int layers[SLOT_COUNT]);
+    bool isPacked() const { return _packed; }
+    // Forgets which arrays are bound, so the next packed material binds its own
+    static void resetArrayBindings();
+
+    // Features the material's textures enable - NORMAL_MAP, TEXTURE_ARRAYS
+    const ShaderDefines& getDefines() const { return _defines; }
+    // Materials sort in creation order, so draws using the same one can be grouped
+    uint32_t getSortKey() const { return _sortKey; }
+
+private:
+    MaterialTexture _textures[SLOT_COUNT];
+    bool _packed { false };
+    float _shininess { 0.0f };
+    ShaderDefines _defines;
+    uint32_t _sortKey;
+};
+
+#endif /* __MATERIAL__ */
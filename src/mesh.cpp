@@ -1,78 +1,177 @@
 #include "mesh.h"
 
-Mesh::Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+#include <algorithm>
+
+#include "jobs.h"
+#include "meshSimplifier.h"
+
+bool Mesh::validateQuantization = false;
+
+Mesh::Mesh(vector<Vertex> vertices, vector<unsigned int> indices, shared_ptr<Material> material, VertexFormat format, unsigned int lodCount)
 {
     this->vertices = vertices;
     this->indices = indices;
-    this->textures = textures;
+    _material = material ? material : std::make_shared<Material>();
+    _format = format;
 
+    computeBounds();
+    generateLods(lodCount);
     setupMesh();
 }
 
+void Mesh::computeBounds()
+{
+    _boundsMin = glm::vec3(0.0f);
+    _boundsMax = glm::vec3(0.0f);
+    if (vertices.empty()) return;
+
+    _boundsMin = _boundsMax = vertices[0].Position;
+    for (const Vertex &v : vertices) {
+        _boundsMin = glm::min(_boundsMin, v.Position);
+        _boundsMax = glm::max(_boundsMax, v.Position);
+    }
+}
+
+/**
+ * @brief Builds up to `lodCount` simplified versions of the mesh, each with roughly half
+ * the triangles of the previous one. Stops early once simplification stops paying off.
+ */
+void Mesh::generateLods(unsigned int lodCount)
+{
+    const float maxError = 0.05f;
+
+    _lods.clear();
+    _lodIndices = indices;
+    _lods.push_back({ 0, (unsigned int)indices.size(), 0.0f });
+
+    // Every level simplifies the full mesh, so they can all be built at once
+    vector<size_t> targets;
+    size_t targetIndexCount = indices.size();
+    for (unsigned int i = 0; i < lodCount; i++) {
+        targetIndexCount = (targetIndexCount / 6) * 3;
+        if (targetIndexCount < 3) break;
+        targets.push_back(targetIndexCount);
+    }
+
+    vector<vector<unsigned int>> levels(targets.size());
+    vector<float> errors(targets.size());
+    JobSystem::instance().parallelFor(targets.size(), 1, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++)
+            levels[i] = simplifyMesh(vertices, indices, targets[i], maxError, &errors[i]);
+    });
+
+    for (unsigned int i = 0; i < levels.size(); i++) {
+        const vector<unsigned int> &lodIndices = levels[i];
+        float error = errors[i];
+
+        // Not worth a LOD if it didn't remove at least a quarter of the previous level's triangles
+        if (lodIndices.size() * 4 > _lods.back().indexCount * 3) break;
+
+        _lods.push_back({ (unsigned int)_lodIndices.size(), (unsigned int)lodIndices.size(), error });
+        _lodIndices.insert(_lodIndices.end(), lodIndices.begin(), lodIndices.end());
+    }
+
+    if (_lods.size() > 1) {
+        std::cout << "Generated " << _lods.size() - 1 << " LODs, triangles:";
+        for (const MeshLod &lod : _lods) std::cout << " " << lod.indexCount / 3;
+        std::cout << ", max error " << _lods.back().error << std::endl;
+    }
+}
+
 void Mesh::setupMesh()
 {
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-  
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), 
-                 &indices[0], GL_STATIC_DRAW);
-
-    // vertex positions
-    glEnableVertexAttribArray(0);	
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    // vertex normals
-    glEnableVertexAttribArray(1);	
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-    // vertex texture coords
-    glEnableVertexAttribArray(2);	
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-    // vertex tangent vectors
-    glEnableVertexAttribArray(3);	
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-
-    glBindVertexArray(0);
+    _pool = &GeometryPool::forFormat(_format);
+    _geometry = _pool->allocate(_format.pack(vertices, _boundsMin, _boundsMax), _lodIndices);
+
+    if (validateQuantization) {
+        QuantizationError error = measureQuantizationError();
+        std::cout << "Mesh quantization (" << vertices.size() << " vertices, " 
+                  << _format.stride() << " bytes each): "
+                  << "position max " << error.maxPosition << " mean " << error.meanPosition
+                  << ", normal max " << error.maxNormalDegrees << " deg"
+                  << ", tangent max " << error.maxTangentDegrees << " deg"
+                  << ", uv max " << error.maxTexCoord
+                  << ", flipped bitangents " << error.flippedBitangents << std::endl;
+    }
+}
+
+void Mesh::release()
+{
+    if (_pool) _pool->release(_geometry);
 }
 
-void Mesh::draw(Shader &shader) 
+void Mesh::getPositionDecode(glm::vec3 &offset, glm::vec3 &scale) const
 {
-    unsigned int diffuseNr = 1;
-    unsigned int specularNr = 1;
-    shader.setBool("material.hasNormalMap", false);
-    for(unsigned int i = 0; i < textures.size(); i++)
-    {
-        glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
-        // retrieve texture number (the N in diffuse_textureN)
-        string number;
-        string name = textures[i].type;
-
-        if (name == "textureNormal") {
-            shader.setInt("material.textureNormal", i);
-            shader.setBool("material.hasNormalMap", true);
-            glBindTexture(GL_TEXTURE_2D, textures[i].ID);
-            continue;
-        }
-
-        if(name == "texturesDiffuse")
-            number = std::to_string(diffuseNr++);
-        else if(name == "texturesSpecular")
-            number = std::to_string(specularNr++);
-
-        shader.setInt(("material." + name + "[" + number + "]").c_str(), i);
-        glBindTexture(GL_TEXTURE_2D, textures[i].ID);
+    if (_format.quantizePositions) {
+        offset = _boundsMin;
+        scale = _boundsMax - _boundsMin;
+    } else {
+        offset = glm::vec3(0.0f);
+        scale = glm::vec3(1.0f);
     }
-    shader.setFloat("material.shininess", shininess);
+}
+
+void Mesh::draw(ShaderVariants &variants, unsigned int lod)
+{
+    Shader &shader = variants.get(_material->getDefines());
+    shader.use();
+    draw(shader, lod);
+}
+
+void Mesh::draw(Shader &shader, unsigned int lod) 
+{
+    const MeshProgramBindings &bindings = MeshProgramBindings::of(shader);
+    _material->bind(bindings);
+
+    glm::vec3 offset, scale;
+    getPositionDecode(offset, scale);
+    glUniform3f(bindings.positionOffset, offset.x, offset.y, offset.z);
+    glUniform3f(bindings.positionScale, scale.x, scale.y, scale.z);
 
-    glActiveTexture(GL_TEXTURE0);
+    if (!_geometry.valid()) return;
 
-    // draw mesh
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
-}  
\ No newline at end of file
+    // draw mesh - every mesh of this format shares the VAO, so consecutive draws don't change vertex state
+    _pool->bind();
+    const MeshLod &range = _lods[std::min(lod, (unsigned int)_lods.size() - 1)];
+    glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT, 
+                             (void*)((size_t)(_geometry.firstIndex + range.indexOffset) * sizeof(unsigned int)), 
+                             _geometry.baseVertex);
+}
+
+/**
+ * @brief Compares the mesh's vertices against what the GPU will decode from the packed
+ * vertex buffer.
+ */
+QuantizationError Mesh::measureQuantizationError() const
+{
+    QuantizationError error;
+    if (vertices.empty()) return error;
+
+    vector<Vertex> decoded = _format.unpack(_format.pack(vertices, _boundsMin, _boundsMax), _boundsMin, _boundsMax);
+
+    auto angleDegrees = [](glm::vec3 a, glm::vec3 b) {
+        if (glm::length(a) == 0.0f || glm::length(b) == 0.0f) return 0.0f;
+        float cosine = glm::clamp(glm::dot(glm::normalize(a), glm::normalize(b)), -1.0f, 1.0f);
+        return glm::degrees(std::acos(cosine));
+    };
+
+    double positionSum = 0.0;
+    for (unsigned int i = 0; i < vertices.size(); i++) {
+        const Vertex &a = vertices[i];
+        const Vertex &b = decoded[i];
+
+        float positionError = glm::length(a.Position - b.Position);
+        positionSum += positionError;
+        error.maxPosition = std::max(error.maxPosition, positionError);
+        error.maxNormalDegrees = std::max(error.maxNormalDegrees, angleDegrees(a.Normal, b.Normal));
+        error.maxTangentDegrees = std::max(error.maxTangentDegrees, angleDegrees(a.Tangent, b.Tangent));
+
+        glm::vec2 uvError = glm::abs(a.TexCoords - b.TexCoords);
+        error.maxTexCoord = std::max(error.maxTexCoord, std::max(uvError.x, uvError.y));
+        if ((a.BitangentSign < 0.0f) != (b.BitangentSign < 0.0f))
+            error.flippedBitangents++;
+    }
+    error.meanPosition = (float)(positionSum / vertices.size());
+
+    return error;
+}
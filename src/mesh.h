@@ -3,14 +3,32 @@
 
 #include "global.h"
 
-#include "texture.h"
+#include "material.h"
 #include "shader.h"
+#include "shaderVariants.h"
+#include "vertexFormat.h"
+#include "geometryPool.h"
 
-struct Vertex {
-    glm::vec3 Position;
-    glm::vec3 Normal;
-    glm::vec2 TexCoords;
-    glm::vec3 Tangent;
+/**
+ * @brief Error introduced by packing a mesh's vertices into a compact VertexFormat.
+ */
+struct QuantizationError {
+    float maxPosition { 0.0f };
+    float meanPosition { 0.0f };
+    float maxNormalDegrees { 0.0f };
+    float maxTangentDegrees { 0.0f };
+    float maxTexCoord { 0.0f };
+    unsigned int flippedBitangents { 0 };
+};
+
+/**
+ * @brief A range of the mesh's index buffer which draws one level of detail.
+ */
+struct MeshLod {
+    unsigned int indexOffset;
+    unsigned int indexCount;
+    // Simplification error, relative to the mesh's largest extent
+    float error;
 };
 
 class Mesh {
@@ -18,15 +36,49 @@ class Mesh {
         // mesh data
         vector<Vertex>       vertices;
         vector<unsigned int> indices;
-        vector<Texture>      textures;
-        float shininess { 0.0f };
 
-        Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures);
-        void draw(Shader &shader);
+        // If true, every mesh measures and prints its quantization error when uploaded
+        static bool validateQuantization;
+
+        // An untextured material is used if `material` is null
+        Mesh(vector<Vertex> vertices, vector<unsigned int> indices, shared_ptr<Material> material,
+             VertexFormat format = VertexFormat(), unsigned int lodCount = 0);
+        // The shader must be in use
+        void draw(Shader &shader, unsigned int lod = 0);
+        // Draws with the variant matching the mesh's material, which it binds
+        void draw(ShaderVariants &variants, unsigned int lod = 0);
+        // Returns the mesh's geometry to its pool. Copies of the mesh share the geometry.
+        void release();
+
+        unsigned int getLodCount() const { return _lods.size(); }
+        const MeshLod& getLod(unsigned int lod) const { return _lods[lod]; }
+        const vector<unsigned int>& getLodIndices() const { return _lodIndices; }
+        // Null until the mesh is uploaded
+        GeometryPool* getPool() const { return _pool; }
+        const GeometryAllocation& getGeometry() const { return _geometry; }
+
+        // How the shader decodes positions - identity for float positions
+        void getPositionDecode(glm::vec3 &offset, glm::vec3 &scale) const;
+        const Material& getMaterial() const { return *_material; }
+        const shared_ptr<Material>& getSharedMaterial() const { return _material; }
+        const VertexFormat& getFormat() const { return _format; }
+        glm::vec3 getBoundsMin() const { return _boundsMin; }
+        glm::vec3 getBoundsMax() const { return _boundsMax; }
+
+        QuantizationError measureQuantizationError() const;
     private:
         //  render data
-        unsigned int VAO, VBO, EBO;
+        GeometryPool *_pool { nullptr };
+        GeometryAllocation _geometry;
+        VertexFormat _format;
+        shared_ptr<Material> _material;
+        glm::vec3 _boundsMin, _boundsMax;
+        // LOD 0 is the full mesh; all LODs share one index allocation
+        vector<MeshLod> _lods;
+        vector<unsigned int> _lodIndices;
 
+        void computeBounds();
+        void generateLods(unsigned int lodCount);
         void setupMesh();
 };  
 
@@ -0,0 +1,265 @@
+#include "meshSimplifier.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+/**
+ * @brief Symmetric 4x4 matrix measuring the sum of squared distances to a set of planes.
+ */
+struct Quadric {
+    double a2 { 0 }, ab { 0 }, ac { 0 }, ad { 0 };
+    double b2 { 0 }, bc { 0 }, bd { 0 };
+    double c2 { 0 }, cd { 0 };
+    double d2 { 0 };
+
+    static Quadric fromPlane(glm::dvec3 n, double d, double weight) {
+        Quadric q;
+        q.a2 = n.x * n.x * weight; q.ab = n.x * n.y * weight; q.ac = n.x * n.z * weight; q.ad = n.x * d * weight;
+        q.b2 = n.y * n.y * weight; q.bc = n.y * n.z * weight; q.bd = n.y * d * weight;
+        q.c2 = n.z * n.z * weight; q.cd = n.z * d * weight;
+        q.d2 = d * d * weight;
+        return q;
+    }
+
+    void operator+=(const Quadric &o) {
+        a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+        b2 += o.b2; bc += o.bc; bd += o.bd;
+        c2 += o.c2; cd += o.cd;
+        d2 += o.d2;
+    }
+
+    double evaluate(glm::dvec3 p) const {
+        double result = a2 * p.x * p.x + 2.0 * ab * p.x * p.y + 2.0 * ac * p.x * p.z + 2.0 * ad * p.x
+                      + b2 * p.y * p.y + 2.0 * bc * p.y * p.z + 2.0 * bd * p.y
+                      + c2 * p.z * p.z + 2.0 * cd * p.z
+                      + d2;
+        return result < 0.0 ? 0.0 : result;
+    }
+};
+
+struct Collapse {
+    unsigned int from, to;  // position ids
+    unsigned int toWedge;   // vertex the collapsed corners are remapped to
+    double cost;
+};
+
+template <typename T>
+struct BytesHash {
+    size_t operator()(const T &value) const {
+        // FNV-1a over the raw bytes
+        const unsigned char *bytes = reinterpret_cast<const unsigned char*>(&value);
+        size_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < sizeof(T); i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+};
+
+template <typename T>
+struct BytesEqual {
+    bool operator()(const T &a, const T &b) const { return memcmp(&a, &b, sizeof(T)) == 0; }
+};
+
+glm::dvec3 triangleNormal(glm::dvec3 a, glm::dvec3 b, glm::dvec3 c) {
+    return glm::cross(b - a, c - a);
+}
+
+}
+
+vector<unsigned int> simplifyMesh(const vector<Vertex> &vertices, const vector<unsigned int> &indices,
+                                  size_t targetIndexCount, float maxError, float *resultError)
+{
+    if (resultError) *resultError = 0.0f;
+    if (indices.size() <= targetIndexCount || vertices.empty()) return indices;
+
+    // Weld identical vertices (wedges) and vertices with identical positions
+    vector<unsigned int> wedgeOf(vertices.size());
+    vector<unsigned int> posOf(vertices.size());
+    vector<glm::dvec3> positions;
+    {
+        std::unordered_map<Vertex, unsigned int, BytesHash<Vertex>, BytesEqual<Vertex>> wedges;
+        std::unordered_map<glm::vec3, unsigned int, BytesHash<glm::vec3>, BytesEqual<glm::vec3>> positionIds;
+        for (unsigned int i = 0; i < vertices.size(); i++) {
+            wedgeOf[i] = wedges.emplace(vertices[i], i).first->second;
+            auto inserted = positionIds.emplace(vertices[i].Position, (unsigned int)positions.size());
+            if (inserted.second) positions.push_back(glm::dvec3(vertices[i].Position));
+            posOf[i] = inserted.first->second;
+        }
+    }
+    const unsigned int positionCount = positions.size();
+
+    // Seams: one position shared by several distinct wedges
+    vector<unsigned int> wedgeAtPos(positionCount, ~0u);
+    vector<bool> locked(positionCount, false);
+    for (unsigned int i = 0; i < vertices.size(); i++) {
+        if (wedgeOf[i] != i) continue;
+        unsigned int &wedge = wedgeAtPos[posOf[i]];
+        if (wedge == ~0u) wedge = i;
+        else if (wedge != i) locked[posOf[i]] = true;
+    }
+
+    // Triangles in wedge ids, dropping any degenerate input
+    vector<unsigned int> triangles;
+    triangles.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        unsigned int a = wedgeOf[indices[i]], b = wedgeOf[indices[i + 1]], c = wedgeOf[indices[i + 2]];
+        if (posOf[a] == posOf[b] || posOf[b] == posOf[c] || posOf[a] == posOf[c]) continue;
+        triangles.push_back(a);
+        triangles.push_back(b);
+        triangles.push_back(c);
+    }
+
+    // Borders: edges used by exactly one triangle. Non-manifold edges are locked too.
+    {
+        std::unordered_map<uint64_t, unsigned int> edgeUses;
+        auto edgeKey = [](unsigned int a, unsigned int b) {
+            return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+        };
+        for (size_t t = 0; t < triangles.size(); t += 3) {
+            for (int e = 0; e < 3; e++) {
+                edgeUses[edgeKey(posOf[triangles[t + e]], posOf[triangles[t + (e + 1) % 3]])]++;
+            }
+        }
+        for (auto &edge : edgeUses) {
+            if (edge.second != 2) {
+                locked[edge.first >> 32] = true;
+                locked[edge.first & 0xffffffffu] = true;
+            }
+        }
+    }
+
+    // Plane quadrics, weighted by triangle area
+    vector<Quadric> quadrics(positionCount);
+    for (size_t t = 0; t < triangles.size(); t += 3) {
+        glm::dvec3 p0 = positions[posOf[triangles[t]]];
+        glm::dvec3 p1 = positions[posOf[triangles[t + 1]]];
+        glm::dvec3 p2 = positions[posOf[triangles[t + 2]]];
+        glm::dvec3 normal = triangleNormal(p0, p1, p2);
+        double length = glm::length(normal);
+        if (length == 0.0) continue;
+        normal /= length;
+
+        Quadric q = Quadric::fromPlane(normal, -glm::dot(normal, p0), length * 0.5);
+        for (int c = 0; c < 3; c++) quadrics[posOf[triangles[t + c]]] += q;
+    }
+
+    // Errors are relative to the mesh size
+    glm::dvec3 boundsMin = positions[0], boundsMax = positions[0];
+    for (const glm::dvec3 &p : positions) {
+        boundsMin = glm::min(boundsMin, p);
+        boundsMax = glm::max(boundsMax, p);
+    }
+    glm::dvec3 extent = boundsMax - boundsMin;
+    double scale = std::max(extent.x, std::max(extent.y, extent.z));
+    double costLimit = (double)maxError * scale;
+    costLimit *= costLimit;
+    double worstCost = 0.0;
+
+    vector<unsigned int> wedgeRemap(vertices.size());
+    vector<vector<unsigned int>> adjacency(positionCount);
+    vector<bool> touched(positionCount);
+    vector<Collapse> collapses;
+
+    while (triangles.size() > targetIndexCount) {
+        // Position -> triangle adjacency for this pass
+        for (auto &list : adjacency) list.clear();
+        for (unsigned int t = 0; t < triangles.size(); t += 3) {
+            for (int c = 0; c < 3; c++) adjacency[posOf[triangles[t + c]]].push_back(t);
+        }
+
+        // Candidate half-edge collapses, cheapest first
+        collapses.clear();
+        for (size_t t = 0; t < triangles.size(); t += 3) {
+            for (int e = 0; e < 3; e++) {
+                unsigned int wa = triangles[t + e], wb = triangles[t + (e + 1) % 3];
+                unsigned int a = posOf[wa], b = posOf[wb];
+                if (!locked[a]) {
+                    Quadric q = quadrics[a];
+                    q += quadrics[b];
+                    collapses.push_back({ a, b, wb, q.evaluate(positions[b]) });
+                }
+                if (!locked[b]) {
+                    Quadric q = quadrics[b];
+                    q += quadrics[a];
+                    collapses.push_back({ b, a, wa, q.evaluate(positions[a]) });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y) {
+            return x.cost < y.cost;
+        });
+
+        for (unsigned int i = 0; i < wedgeRemap.size(); i++) wedgeRemap[i] = i;
+        std::fill(touched.begin(), touched.end(), false);
+        size_t triangleCount = triangles.size() / 3;
+        size_t collapsed = 0;
+
+        for (const Collapse &collapse : collapses) {
+            if (collapse.cost > costLimit) break;
+            if (triangleCount * 3 <= targetIndexCount) break;
+            if (touched[collapse.from] || touched[collapse.to]) continue;
+
+            // Reject collapses which flip or degenerate any remaining triangle
+            bool valid = true;
+            size_t removed = 0;
+            for (unsigned int t : adjacency[collapse.from]) {
+                glm::dvec3 before[3], after[3];
+                bool containsTarget = false;
+                for (int c = 0; c < 3; c++) {
+                    unsigned int p = posOf[triangles[t + c]];
+                    containsTarget |= p == collapse.to;
+                    before[c] = positions[p];
+                    after[c] = p == collapse.from ? positions[collapse.to] : positions[p];
+                }
+                if (containsTarget) {
+                    removed++;
+                    continue;
+                }
+
+                glm::dvec3 normalBefore = triangleNormal(before[0], before[1], before[2]);
+                glm::dvec3 normalAfter = triangleNormal(after[0], after[1], after[2]);
+                double lengthAfter = glm::length(normalAfter);
+                if (lengthAfter == 0.0 || glm::dot(normalBefore, normalAfter) <= 0.25 * glm::length(normalBefore) * lengthAfter) {
+                    valid = false;
+                    break;
+                }
+            }
+            if (!valid) continue;
+
+            wedgeRemap[wedgeAtPos[collapse.from]] = collapse.toWedge;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            worstCost = std::max(worstCost, collapse.cost);
+
+            // Triangles around the collapsed vertex are stale until the next pass
+            touched[collapse.from] = touched[collapse.to] = true;
+            for (unsigned int t : adjacency[collapse.from]) {
+                for (int c = 0; c < 3; c++) touched[posOf[triangles[t + c]]] = true;
+            }
+
+            triangleCount -= removed;
+            collapsed++;
+        }
+
+        if (collapsed == 0) break;
+
+        // Apply this pass's collapses and drop degenerate triangles
+        size_t write = 0;
+        for (size_t t = 0; t < triangles.size(); t += 3) {
+            unsigned int a = wedgeRemap[triangles[t]], b = wedgeRemap[triangles[t + 1]], c = wedgeRemap[triangles[t + 2]];
+            if (posOf[a] == posOf[b] || posOf[b] == posOf[c] || posOf[a] == posOf[c]) continue;
+            triangles[write++] = a;
+            triangles[write++] = b;
+            triangles[write++] = c;
+        }
+        triangles.resize(write);
+    }
+
+    if (resultError && scale > 0.0) *resultError = (float)(sqrt(worstCost) / scale);
+
+    return triangles;
+}
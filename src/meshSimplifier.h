@@ -0,0 +1,26 @@
+#ifndef __MESHSIMPLIFIER__
+#define __MESHSIMPLIFIER__
+
+#include "global.h"
+
+#include "vertexFormat.h"
+
+/**
+ * @brief Simplifies a triangle list with quadric error metric half-edge collapses.
+ *
+ * Vertices are only ever collapsed onto existing vertices, so the result indexes the
+ * same vertex buffer as the input and LODs can share a single VBO. Vertices on UV or
+ * normal seams (same position, different attributes) and on open borders are never
+ * moved, which keeps seams and silhouettes intact.
+ *
+ * @param vertices Vertex data referenced by indices.
+ * @param indices Triangle list to simplify.
+ * @param targetIndexCount Stop once the triangle list is this small.
+ * @param maxError Largest allowed error, relative to the mesh's largest extent.
+ * @param resultError If not null, receives the error of the result, relative to the mesh's largest extent.
+ * @return The simplified triangle list.
+ */
+vector<unsigned int> simplifyMesh(const vector<Vertex> &vertices, const vector<unsigned int> &indices,
+                                  size_t targetIndexCount, float maxError, float *resultError = nullptr);
+
+#endif /* __MESHSIMPLIFIER__ */
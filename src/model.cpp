@@ -2,14 +2,106 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include <assimp/types.h>
-#include <stb_image.h>
+#include <algorithm>
+#include <chrono>
 
 #include "model.h"
+#include "jobs.h"
 
-void Model::draw(Shader &shader)
+void Model::draw(Shader &shader, unsigned int lod)
 {
     for(unsigned int i = 0; i < meshes.size(); i++)
-        meshes[i].draw(shader);
+        meshes[i].draw(shader, lod);
+}
+
+void Model::draw(ShaderVariants &variants, unsigned int lod)
+{
+    for(unsigned int i = 0; i < meshes.size(); i++)
+        meshes[i].draw(variants, lod);
+}
+
+/**
+ * @brief Frees the model's geometry. The model must not be drawn afterwards.
+ */
+void Model::release()
+{
+    for (Mesh &mesh : meshes)
+        mesh.release();
+}
+
+/**
+ * @brief Number of LODs available, including the full mesh. Meshes with fewer LODs
+ * draw their coarsest one.
+ */
+unsigned int Model::getLodCount() const
+{
+    unsigned int count = 1;
+    for (const Mesh &mesh : meshes)
+        count = std::max(count, mesh.getLodCount());
+    return count;
+}
+
+/**
+ * @brief Triangles in the full detail meshes.
+ */
+unsigned int Model::getTriangleCount() const
+{
+    unsigned int count = 0;
+    for (const Mesh &mesh : meshes)
+        count += mesh.getLod(0).indexCount / 3;
+    return count;
+}
+
+void Model::getBounds(glm::vec3 &boundsMin, glm::vec3 &boundsMax) const
+{
+    boundsMin = boundsMax = glm::vec3(0.0f);
+    for (unsigned int i = 0; i < meshes.size(); i++) {
+        boundsMin = i == 0 ? meshes[i].getBoundsMin() : glm::min(boundsMin, meshes[i].getBoundsMin());
+        boundsMax = i == 0 ? meshes[i].getBoundsMax() : glm::max(boundsMax, meshes[i].getBoundsMax());
+    }
+}
+
+/**
+ * @brief Nearest intersection of a ray with the full detail meshes, in model space.
+ *
+ * @param distance Set to the hit distance, in multiples of `direction`.
+ * @return false if the ray misses.
+ */
+bool Model::intersectRay(const glm::vec3 &origin, const glm::vec3 &direction, float &distance) const
+{
+    distance = INFINITY;
+    for (const Mesh &mesh : meshes) {
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            // Moller-Trumbore, hitting both faces
+            const glm::vec3 &v0 = mesh.vertices[mesh.indices[i]].Position;
+            glm::vec3 edge1 = mesh.vertices[mesh.indices[i + 1]].Position - v0;
+            glm::vec3 edge2 = mesh.vertices[mesh.indices[i + 2]].Position - v0;
+            glm::vec3 p = glm::cross(direction, edge2);
+            float det = glm::dot(edge1, p);
+            if (std::abs(det) < 1e-12f) continue;
+
+            float inverseDet = 1.0f / det;
+            glm::vec3 s = origin - v0;
+            float u = glm::dot(s, p) * inverseDet;
+            if (u < 0.0f || u > 1.0f) continue;
+            glm::vec3 q = glm::cross(s, edge1);
+            float v = glm::dot(direction, q) * inverseDet;
+            if (v < 0.0f || u + v > 1.0f) continue;
+
+            float t = glm::dot(edge2, q) * inverseDet;
+            if (t >= 0.0f && t < distance) distance = t;
+        }
+    }
+    return distance != INFINITY;
+}
+
+void Model::getMaterials(vector<shared_ptr<Material>> &materials) const
+{
+    for (const Mesh &mesh : meshes) {
+        const shared_ptr<Material> &material = mesh.getSharedMaterial();
+        if (std::find(materials.begin(), materials.end(), material) == materials.end())
+            materials.push_back(material);
+    }
 }
 
 void Model::loadModel(string path)
@@ -24,9 +116,98 @@ void Model::loadModel(string path)
     }
     directory = path.substr(0, path.find_last_of('/'));
 
+    loadTextures(scene);
+    _materials.assign(scene->mNumMaterials, nullptr);
     processNode(scene->mRootNode, scene);
+    // Meshes sharing a material draw one after another
+    std::stable_sort(meshes.begin(), meshes.end(), [](const Mesh &a, const Mesh &b) {
+        return a.getMaterial().getSortKey() < b.getMaterial().getSortKey();
+    });
+    buildOccluderMesh();
 }  
 
+/**
+ * @brief Collects the coarsest LOD of every mesh into the model's occluder proxy, keeping
+ * only the vertices it uses.
+ */
+void Model::buildOccluderMesh()
+{
+    _occluder = OccluderMesh();
+    for (const Mesh &mesh : meshes) {
+        const MeshLod &lod = mesh.getLod(mesh.getLodCount() - 1);
+        const unsigned int *indices = mesh.getLodIndices().data() + lod.indexOffset;
+
+        vector<unsigned int> remap(mesh.vertices.size(), ~0u);
+        for (unsigned int i = 0; i < lod.indexCount; i++) {
+            unsigned int &vertex = remap[indices[i]];
+            if (vertex == ~0u) {
+                vertex = _occluder.positions.size();
+                _occluder.positions.push_back(mesh.vertices[indices[i]].Position);
+            }
+            _occluder.indices.push_back(vertex);
+        }
+    }
+}
+
+/**
+ * @brief Loads every texture the scene's materials use. Decoding and mip generation
+ * (or reading the texture cache) runs in parallel on the job pool; only the uploads
+ * happen here.
+ */
+void Model::loadTextures(const aiScene *scene)
+{
+    struct TextureUse {
+        aiTextureType type;
+        string typeName;
+        bool gammaCorrect;
+    };
+    const TextureUse uses[] = {
+        { aiTextureType_DIFFUSE, "texturesDiffuse", true },
+        { aiTextureType_SPECULAR, "texturesSpecular", false },
+        { aiTextureType_HEIGHT, "textureNormal", false },
+    };
+
+    vector<string> names;
+    vector<string> typeNames;
+    vector<bool> gammaCorrect;
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned int m = 0; m < scene->mNumMaterials; m++) {
+        aiMaterial *material = scene->mMaterials[m];
+        for (const TextureUse &use : uses) {
+            for (unsigned int i = 0; i < material->GetTextureCount(use.type); i++) {
+                aiString nameRaw;
+                material->GetTexture(use.type, i, &nameRaw);
+                string name = nameRaw.C_Str();
+                if (std::find(names.begin(), names.end(), name) != names.end()) continue;
+
+                names.push_back(name);
+                typeNames.push_back(use.typeName);
+                gammaCorrect.push_back(use.gammaCorrect);
+            }
+        }
+    }
+
+    // One texture per job
+    vector<PreparedTexture> prepared(names.size());
+    JobSystem::instance().parallelFor(names.size(), 1, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++)
+            prepared[i] = Texture::prepare(directory + "/" + names[i], gammaCorrect[i], typeNames[i] == "textureNormal");
+    });
+
+    for (unsigned int i = 0; i < prepared.size(); i++) {
+        Texture texture(prepared[i]);
+        texture.type = typeNames[i];
+        texture.path = names[i];
+        textures_loaded.push_back(texture);
+    }
+
+    if (!prepared.empty()) {
+        float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Loaded " << prepared.size() << " textures for " << directory << " in " << seconds << "s" << std::endl;
+    }
+}
+
 void Model::processNode(aiNode *node, const aiScene *scene)
 {
     // process all the node's meshes (if any)
@@ -46,7 +227,6 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
 {
     vector<Vertex> vertices;
     vector<unsigned int> indices;
-    vector<Texture> textures;
 
     for(unsigned int i = 0; i < mesh->mNumVertices; i++)
     {
@@ -65,6 +245,10 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
         vector.y = mesh->mTangents[i].y;
         vector.z = mesh->mTangents[i].z;
         vertex.Tangent = vector;
+        if (mesh->mBitangents) {
+            glm::vec3 bitangent(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+            vertex.BitangentSign = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+        }
         if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
         {
             glm::vec2 vec;
@@ -83,10 +267,12 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
         for(unsigned int j = 0; j < face.mNumIndices; j++)
             indices.push_back(face.mIndices[j]);
     }
-    // process material
-    ai_real shininess = 1.0f;
-    if(mesh->mMaterialIndex >= 0)
+    // process material, once for all the meshes using it
+    shared_ptr<Material> &outMaterial = _materials[mesh->mMaterialIndex];
+    if(!outMaterial)
     {
+        vector<Texture> textures;
+        ai_real shininess = 1.0f;
         aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
         vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texturesDiffuse", true);
         textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
@@ -97,11 +283,10 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
         
         // Other properties
         material->Get(AI_MATKEY_SHININESS, shininess);
+        outMaterial = std::make_shared<Material>(textures, shininess);
     }
 
-    Mesh outMesh(vertices, indices, textures);
-    outMesh.shininess = shininess;    
-    return outMesh;
+    return Mesh(vertices, indices, outMaterial, _format, _lodCount);
 } 
 
 vector<Texture> Model::loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName, bool gammaCorrect)
@@ -122,7 +307,7 @@ vector<Texture> Model::loadMaterialTextures(aiMaterial *mat, aiTextureType type,
         }
 
         if (textureIndex == -1) {
-            Texture texture((directory + "/" + name).c_str(), GL_RGB, gammaCorrect);
+            Texture texture((directory + "/" + name).c_str(), gammaCorrect, typeName == "textureNormal");
             texture.type = typeName;
             texture.path = name;
             textures.push_back(texture);
@@ -5,24 +5,48 @@
 #include <assimp/scene.h>
   
 #include "mesh.h"
+#include "occlusionCuller.h"
 
 class Model 
 {
     public:
         Model() { }
-        Model(Mesh &mesh) { meshes.push_back(mesh); }
-        Model(std::string path) {
+        Model(Mesh &mesh) { 
+            meshes.push_back(mesh); 
+            buildOccluderMesh();
+        }
+        Model(std::string path, VertexFormat format = VertexFormat(), unsigned int lodCount = 0) {
+            _format = format;
+            _lodCount = lodCount;
             loadModel(path);
         }
-        void draw(Shader &shader);	
+        void draw(Shader &shader, unsigned int lod = 0);	
+        void draw(ShaderVariants &variants, unsigned int lod = 0);
+        void release();
+
+        const vector<Mesh>& getMeshes() const { return meshes; }
+        unsigned int getLodCount() const;
+        unsigned int getTriangleCount() const;
+        void getBounds(glm::vec3 &boundsMin, glm::vec3 &boundsMax) const;
+        bool intersectRay(const glm::vec3 &origin, const glm::vec3 &direction, float &distance) const;
+        const OccluderMesh& getOccluderMesh() const { return _occluder; }
+        // Appends the materials of the model's meshes which aren't in `materials` yet
+        void getMaterials(vector<shared_ptr<Material>> &materials) const;
         
     private:
         // model data
         vector<Texture> textures_loaded; 
+        // By the scene's material index, shared by every mesh using it
+        vector<shared_ptr<Material>> _materials;
         std::vector<Mesh> meshes;
         std::string directory;
+        VertexFormat _format;
+        unsigned int _lodCount { 0 };
+        OccluderMesh _occluder;
 
         void loadModel(std::string path);
+        void loadTextures(const aiScene *scene);
+        void buildOccluderMesh();
         void processNode(aiNode *node, const aiScene *scene);
         Mesh processMesh(aiMesh *mesh, const aiScene *scene);
         std::vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName, bool gammaCorrect);
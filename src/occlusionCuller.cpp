@@ -0,0 +1,196 @@
+#include "occlusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "jobs.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define OCCLUSION_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace {
+
+// Rows rasterized by one job
+const int BAND_HEIGHT = 16;
+// Vertices closer to the eye plane than this can't be projected
+const float MIN_W = 1e-4f;
+
+}
+
+OcclusionCuller::OcclusionCuller()
+    : _depth(WIDTH * HEIGHT, 1.0f)
+{
+}
+
+void OcclusionCuller::begin(const glm::mat4 &viewProjection)
+{
+    _viewProjection = viewProjection;
+    _triangles.clear();
+    _stats = Stats();
+    std::fill(_depth.begin(), _depth.end(), 1.0f);
+}
+
+void OcclusionCuller::addOccluder(const OccluderMesh &mesh, const glm::mat4 &world)
+{
+    glm::mat4 transform = _viewProjection * world;
+    _clip.resize(mesh.positions.size());
+    for (size_t i = 0; i < mesh.positions.size(); i++)
+        _clip[i] = transform * glm::vec4(mesh.positions[i], 1.0f);
+
+    _stats.occluders++;
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        glm::vec3 screen[3];
+        bool projectable = true;
+        for (int v = 0; v < 3; v++) {
+            const glm::vec4 &clip = _clip[mesh.indices[i + v]];
+            if (clip.w < MIN_W) {
+                projectable = false;
+                break;
+            }
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            screen[v] = glm::vec3((ndc.x * 0.5f + 0.5f) * WIDTH, (ndc.y * 0.5f + 0.5f) * HEIGHT, ndc.z);
+        }
+        // Dropping an occluder triangle only ever makes the test more conservative
+        if (!projectable) continue;
+
+        // Counter clockwise front faces, with y up
+        float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y)
+                   - (screen[1].y - screen[0].y) * (screen[2].x - screen[0].x);
+        if (area <= 0.0f) continue;
+
+        Triangle triangle;
+        triangle.minX = std::max(0, (int)std::floor(std::min({ screen[0].x, screen[1].x, screen[2].x })));
+        triangle.maxX = std::min(WIDTH - 1, (int)std::ceil(std::max({ screen[0].x, screen[1].x, screen[2].x })));
+        triangle.minY = std::max(0, (int)std::floor(std::min({ screen[0].y, screen[1].y, screen[2].y })));
+        triangle.maxY = std::min(HEIGHT - 1, (int)std::ceil(std::max({ screen[0].y, screen[1].y, screen[2].y })));
+        if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) continue;
+
+        // Edge e is opposite vertex e, and is positive on the inside
+        for (int e = 0; e < 3; e++) {
+            const glm::vec3 &a = screen[(e + 1) % 3], &b = screen[(e + 2) % 3];
+            triangle.edgeA[e] = a.y - b.y;
+            triangle.edgeB[e] = b.x - a.x;
+            triangle.edgeC[e] = a.x * b.y - a.y * b.x;
+        }
+
+        // Depth is affine in screen space - weight each vertex by its normalized edge function
+        float inverseArea = 1.0f / area;
+        triangle.depthA = triangle.depthB = triangle.depthC = 0.0f;
+        for (int v = 0; v < 3; v++) {
+            triangle.depthA += triangle.edgeA[v] * inverseArea * screen[v].z;
+            triangle.depthB += triangle.edgeB[v] * inverseArea * screen[v].z;
+            triangle.depthC += triangle.edgeC[v] * inverseArea * screen[v].z;
+        }
+
+        _triangles.push_back(triangle);
+    }
+    _stats.triangles = _triangles.size();
+}
+
+void OcclusionCuller::rasterize()
+{
+    JobSystem::instance().parallelFor(HEIGHT / BAND_HEIGHT, 1, [this](unsigned int begin, unsigned int end) {
+        for (unsigned int band = begin; band < end; band++)
+            rasterizeBand(band * BAND_HEIGHT, (band + 1) * BAND_HEIGHT);
+    });
+}
+
+/**
+ * @brief Rasterizes every triangle over rows [firstRow, endRow). Bands don't share any
+ * pixels, so they can run in parallel.
+ */
+void OcclusionCuller::rasterizeBand(int firstRow, int endRow)
+{
+    for (const Triangle &triangle : _triangles) {
+        int rowBegin = std::max(triangle.minY, firstRow);
+        int rowEnd = std::min(triangle.maxY + 1, endRow);
+        // Four pixel groups, which never cross the end of a row
+        int columnBegin = triangle.minX & ~3;
+
+        for (int y = rowBegin; y < rowEnd; y++) {
+            float *row = &_depth[y * WIDTH];
+            float py = y + 0.5f;
+            float edgeRow[3];
+            for (int e = 0; e < 3; e++)
+                edgeRow[e] = triangle.edgeB[e] * py + triangle.edgeC[e];
+            float depthRow = triangle.depthB * py + triangle.depthC;
+
+#ifdef OCCLUSION_SSE
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            const __m128 a0 = _mm_set1_ps(triangle.edgeA[0]), r0 = _mm_set1_ps(edgeRow[0]);
+            const __m128 a1 = _mm_set1_ps(triangle.edgeA[1]), r1 = _mm_set1_ps(edgeRow[1]);
+            const __m128 a2 = _mm_set1_ps(triangle.edgeA[2]), r2 = _mm_set1_ps(edgeRow[2]);
+            const __m128 depthA = _mm_set1_ps(triangle.depthA), depthR = _mm_set1_ps(depthRow);
+
+            for (int x = columnBegin; x <= triangle.maxX; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+                __m128 inside = _mm_and_ps(_mm_and_ps(
+                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, px), r0), zero),
+                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, px), r1), zero)),
+                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, px), r2), zero));
+                if (_mm_movemask_ps(inside) == 0) continue;
+
+                __m128 depth = _mm_add_ps(_mm_mul_ps(depthA, px), depthR);
+                __m128 current = _mm_loadu_ps(row + x);
+                __m128 closer = _mm_and_ps(inside, _mm_cmplt_ps(depth, current));
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(closer, depth), _mm_andnot_ps(closer, current)));
+            }
+#else
+            for (int x = columnBegin; x <= triangle.maxX; x++) {
+                float px = x + 0.5f;
+                if (triangle.edgeA[0] * px + edgeRow[0] < 0.0f || triangle.edgeA[1] * px + edgeRow[1] < 0.0f
+                    || triangle.edgeA[2] * px + edgeRow[2] < 0.0f) continue;
+
+                float depth = triangle.depthA * px + depthRow;
+                if (depth < row[x]) row[x] = depth;
+            }
+#endif
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) const
+{
+    // Nearest depth and screen rectangle of the box's corners
+    float nearest = INFINITY;
+    glm::vec2 screenMin(INFINITY), screenMax(-INFINITY);
+    for (int c = 0; c < 8; c++) {
+        glm::vec3 corner((c & 1) ? boundsMax.x : boundsMin.x, (c & 2) ? boundsMax.y : boundsMin.y,
+                         (c & 4) ? boundsMax.z : boundsMin.z);
+        glm::vec4 clip = _viewProjection * glm::vec4(corner, 1.0f);
+        // Boxes reaching behind the eye can't be projected
+        if (clip.w < MIN_W) return true;
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        glm::vec2 screen((ndc.x * 0.5f + 0.5f) * WIDTH, (ndc.y * 0.5f + 0.5f) * HEIGHT);
+        nearest = std::min(nearest, ndc.z);
+        screenMin = glm::min(screenMin, screen);
+        screenMax = glm::max(screenMax, screen);
+    }
+
+    // Grown by a pixel, since occluders are only sampled at pixel centres
+    int minX = std::max(0, (int)std::floor(screenMin.x) - 1);
+    int maxX = std::min(WIDTH - 1, (int)std::ceil(screenMax.x) + 1);
+    int minY = std::max(0, (int)std::floor(screenMin.y) - 1);
+    int maxY = std::min(HEIGHT - 1, (int)std::ceil(screenMax.y) + 1);
+    // Off screen - leave it to frustum culling
+    if (minX > maxX || minY > maxY) return true;
+
+    for (int y = minY; y <= maxY; y++) {
+        const float *row = &_depth[y * WIDTH];
+        int x = minX;
+#ifdef OCCLUSION_SSE
+        const __m128 boxDepth = _mm_set1_ps(nearest);
+        for (; x + 3 <= maxX; x += 4) {
+            if (_mm_movemask_ps(_mm_cmple_ps(boxDepth, _mm_loadu_ps(row + x))) != 0) return true;
+        }
+#endif
+        for (; x <= maxX; x++) {
+            if (nearest <= row[x]) return true;
+        }
+    }
+    return false;
+}
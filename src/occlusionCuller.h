@@ -0,0 +1,77 @@
+#ifndef __OCCLUSIONCULLER__
+#define __OCCLUSIONCULLER__
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/**
+ * @brief Triangles an object contributes to the occlusion buffer - usually a coarse LOD,
+ * with only the vertices it uses.
+ */
+struct OccluderMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+
+    bool empty() const { return indices.empty(); }
+};
+
+/**
+ * @brief Software occlusion culling against a small depth buffer rendered on the CPU.
+ *
+ * Each frame, a few large occluders are rasterized into a WIDTH x HEIGHT buffer of NDC
+ * depth, in horizontal bands spread over the job pool, four pixels at a time. Bounding
+ * boxes are then tested against it: a box is hidden if its nearest depth is behind the
+ * buffer over every pixel its projection touches.
+ *
+ * The test is conservative for boxes, but occluders are rasterized at pixel centres, so
+ * their silhouettes can hide objects by up to a pixel of the low resolution buffer.
+ * Tested rectangles are grown by a pixel to absorb that.
+ *
+ * Doesn't touch GL, so it builds as its own library and can be tested without a GPU.
+ */
+class OcclusionCuller
+{
+public:
+    static const int WIDTH = 256;
+    static const int HEIGHT = 128;
+
+    struct Stats {
+        unsigned int occluders { 0 };
+        unsigned int triangles { 0 };
+    };
+
+    OcclusionCuller();
+
+    // Clears the buffer and the occluder list for a new view
+    void begin(const glm::mat4 &viewProjection);
+    // Queues an occluder's triangles. Back faces and triangles crossing the near plane are dropped.
+    void addOccluder(const OccluderMesh &mesh, const glm::mat4 &world);
+    // Rasterizes everything queued since begin()
+    void rasterize();
+
+    // false if the box is certainly hidden behind the occluders
+    bool isVisible(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) const;
+
+    const float* getDepth() const { return _depth.data(); }
+    const Stats& getStats() const { return _stats; }
+
+private:
+    // Screen space triangle with edge functions and a depth plane, in pixels
+    struct Triangle {
+        float edgeA[3], edgeB[3], edgeC[3];
+        float depthA, depthB, depthC;
+        int minX, maxX, minY, maxY;
+    };
+
+    glm::mat4 _viewProjection;
+    std::vector<Triangle> _triangles;
+    // Scratch for transformed occluder vertices
+    std::vector<glm::vec4> _clip;
+    std::vector<float> _depth;
+    Stats _stats;
+
+    void rasterizeBand(int firstRow, int endRow);
+};
+
+#endif /* __OCCLUSIONCULLER__ */
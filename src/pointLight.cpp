@@ -1,4 +1,5 @@
 #include "pointLight.h"
+#include <iterator>
 #include <glm/gtc/matrix_transform.hpp>
 
 PointLight::PointLight(glm::vec3 position, glm::vec3 color, float ambient, float diffuse, float specular, float range, bool castsShadow)
@@ -37,36 +38,64 @@ void PointLight::setRange(float range) {
     _quadratic = pow(13.0f / range, 2.0f) * 0.44f;
 }
 
-void PointLight::bind(Shader &shader, int i, int &textureInd) {
-    shader.setVec3("pointLights[" + std::to_string(i) + "].position", position);
-    shader.setFloat("pointLights[" + std::to_string(i) + "].linear", _linear);
-    shader.setFloat("pointLights[" + std::to_string(i) + "].quadratic", _quadratic);
-    shader.setVec3("pointLights[" + std::to_string(i) + "].ambient", _ambientVec);
-    shader.setVec3("pointLights[" + std::to_string(i) + "].diffuse", _diffuseVec);
-    shader.setVec3("pointLights[" + std::to_string(i) + "].specular", _specularVec);
-    shader.setFloat("pointLights[" + std::to_string(i) + "].range", _range);
-    shader.setBool("pointLights[" + std::to_string(i) + "].castsShadow", _castsShadow);
+namespace {
+
+struct PointLightUniforms {
+    string position, linear, quadratic, ambient, diffuse, specular, range, shadowMap;
+};
+
+/**
+ * @brief Uniform names for the light at `index`, built once rather than every frame.
+ */
+const PointLightUniforms& uniformNames(int index) {
+    static vector<PointLightUniforms> names;
+    while ((int)names.size() <= index) {
+        string prefix = "pointLights[" + std::to_string(names.size()) + "].";
+        names.push_back({
+            prefix + "position", prefix + "linear", prefix + "quadratic", prefix + "ambient", prefix + "diffuse",
+            prefix + "specular", prefix + "range", prefix + "shadowMap",
+        });
+    }
+    return names[index];
+}
+
+const string SHADOW_MATRIX_NAMES[6] = {
+    "shadowMatrices[0]", "shadowMatrices[1]", "shadowMatrices[2]", 
+    "shadowMatrices[3]", "shadowMatrices[4]", "shadowMatrices[5]",
+};
+
+}
+
+void PointLight::bind(Shader &shader, int i, int &textureInd, const glm::vec3 &lightPosition) {
+    const PointLightUniforms &names = uniformNames(i);
+    shader.setVec3(names.position, lightPosition);
+    shader.setFloat(names.linear, _linear);
+    shader.setFloat(names.quadratic, _quadratic);
+    shader.setVec3(names.ambient, _ambientVec);
+    shader.setVec3(names.diffuse, _diffuseVec);
+    shader.setVec3(names.specular, _specularVec);
+    shader.setFloat(names.range, _range);
 
     if (_castsShadow) {
         glActiveTexture(GL_TEXTURE0 + textureInd);
         glBindTexture(GL_TEXTURE_CUBE_MAP, _shadowMap);
-        shader.setInt("pointLights[" + std::to_string(i) + "].shadowMap", textureInd);
+        shader.setInt(names.shadowMap, textureInd);
         textureInd++;
     } 
 }
 
-void PointLight::configureForDepthMap(Shader &shader, int framebuf) {
+void PointLight::configureForDepthMap(Shader &shader, int framebuf, const glm::vec3 &lightPosition, 
+                                      const vector<glm::mat4> &shadowMatrices) {
     glBindFramebuffer(GL_FRAMEBUFFER, framebuf);
     glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, _shadowMap, 0);
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
 
     shader.use();
-    shader.setVec3("lightPos", position);
+    shader.setVec3("lightPos", lightPosition);
     shader.setFloat("farPlane", _range);
-    auto matrices = generateProjectionMatrices();
-    for (int i = 0; i < matrices.size(); i++) {
-        shader.setMat4("shadowMatrices[" + std::to_string(i) + "]", matrices[i]);
+    for (size_t i = 0; i < shadowMatrices.size() && i < std::size(SHADOW_MATRIX_NAMES); i++) {
+        shader.setMat4(SHADOW_MATRIX_NAMES[i], shadowMatrices[i]);
     }
     glViewport(0, 0, SHADOW_SIZE, SHADOW_SIZE);
     glClear(GL_DEPTH_BUFFER_BIT);
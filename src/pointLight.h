@@ -17,8 +17,10 @@ public:
 
     float getRange() { return _range; }
     void setRange(float range);
-    void bind(Shader &shader, int index, int &textureInd);
-    void configureForDepthMap(Shader &shader, int framebuf);
+    // Light state is passed in as it was when the frame was prepared
+    void bind(Shader &shader, int index, int &textureInd, const glm::vec3 &lightPosition);
+    void configureForDepthMap(Shader &shader, int framebuf, const glm::vec3 &lightPosition, 
+                              const vector<glm::mat4> &shadowMatrices);
 
     vector<glm::mat4> generateProjectionMatrices();
 };
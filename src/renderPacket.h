@@ -0,0 +1,71 @@
+#ifndef __RENDERPACKET__
+#define __RENDERPACKET__
+
+#include "global.h"
+#include <cstdint>
+
+#include "sceneStore.h"
+
+class Model;
+class PointLight;
+
+/**
+ * @brief One object to draw in one pass, with its transform as it was when the frame
+ * was prepared.
+ */
+struct DrawItem {
+    Model *model;
+    glm::mat4 world;
+    glm::mat3 normal;
+    unsigned int lod;
+    // World space
+    glm::vec3 boundsMin, boundsMax;
+    // Front to back within the pass
+    uint64_t sortKey;
+    // Set for objects gated by their own occlusion query, which is keyed by handle
+    SceneHandle query;
+    // Drawn in the depth pre-pass
+    bool depthPrepass { false };
+    // The item's ObjectBlock in the upload ring, written by the GL thread before submission
+    size_t uniformOffset { 0 };
+};
+
+struct PointLightPacket {
+    PointLight *light;
+    glm::vec3 position;
+    // Empty if the light doesn't cast shadows
+    vector<glm::mat4> shadowMatrices;
+    vector<DrawItem> casters;
+};
+
+/**
+ * @brief Everything the GL thread needs to submit a frame. Built on a worker thread,
+ * so it must not be read while being prepared.
+ */
+struct RenderPacket {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 cameraPosition;
+
+    // Objects in the depth pre-pass come first
+    vector<DrawItem> deferred;
+    unsigned int prepassCount { 0 };
+    vector<DrawItem> forward;
+    // Deferred objects hidden in the last depth pyramid, drawn only if their bounds pass an occlusion query
+    vector<DrawItem> hizCulled;
+
+    glm::vec3 dirLightDirection;
+    glm::mat4 dirLightSpaceMatrix;
+    vector<DrawItem> dirLightCasters;
+
+    vector<PointLightPacket> pointLights;
+
+    // Objects inside the camera frustum
+    unsigned int visibleCount { 0 };
+    // Of those, objects hidden by occluders
+    unsigned int occludedCount { 0 };
+    // Objects with their own occlusion query
+    unsigned int queriedCount { 0 };
+};
+
+#endif /* __RENDERPACKET__ */
@@ -0,0 +1,16 @@
+#ifndef __RENDERPASS__
+#define __RENDERPASS__
+
+/**
+ * @brief The scene passes which draw GameObjects. Used by objects to pick per-pass
+ * state such as their level of detail.
+ */
+enum class RenderPass {
+    GEOMETRY = 0,
+    SHADOW,
+    FORWARD,
+};
+
+const unsigned int RENDER_PASS_COUNT = 3;
+
+#endif /* __RENDERPASS__ */
@@ -2,15 +2,24 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "shader.h"
 #include "texture.h"
+#include "glExtensions.h"
+#include "jobs.h"
+#include "geometryPool.h"
 
 using glm::vec2;
 using glm::vec3;
 
+// Occlusion culling outcome for each visible object during frame preparation
+enum Occlusion : uint8_t { VISIBLE, OCCLUDED, HIZ_CULLED };
+
 //
 // Singleton management
 //
@@ -53,7 +62,30 @@ Renderer::Renderer(int resX, int resY) {
     _targetResolution = glm::ivec2(resX, resY);
 }
 
+/**
+ * @brief Deletes every GL object the renderer and its parts own, then terminates GLFW.
+ *
+ * Nothing deletes GL objects in its destructor: members and statics are destroyed after
+ * glfwTerminate(), with no context left to delete them in. Each owner has a release()
+ * instead, called here while the context is still current.
+ */
 Renderer::~Renderer() {
+    _textureArrays.release();
+    _deferredPass.release();
+    _hdrPass.release();
+    _gaussianPass.release();
+    _brightnessPass.release();
+    _quadPass.release();
+    _bloomRenderer.destroy();
+    _ssaoRenderer.release();
+    _hiZRenderer.release();
+    glDeleteQueries(2, _overdrawQueries);
+    _boundsQueries.release();
+    _objectQueries.release();
+    _uploadRing.release();
+    if (glExtensions.multiDrawIndirect) _indirectDraws.release();
+    GeometryPool::releaseAll();
+    FullscreenPass::releaseShared();
     glfwTerminate();
 }
 
@@ -87,6 +119,7 @@ int Renderer::init() {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return 1;
     }    
+    loadGLExtensions();
 
     // gl config
     glViewport(0, 0, _targetResolution.x, _targetResolution.y);
@@ -215,18 +248,43 @@ int Renderer::init() {
     // Debug config
     debugConfiguration();
 
+    // Compile every shader together, checking them once they have all been submitted
+    ShaderBatch shaderBatch;
+    auto shadersStart = std::chrono::steady_clock::now();
+
     // Compile basic shaders
-    _objectShader = Shader("../src/shaders/object.vs", "../src/shaders/object.fs");
-    _depthShaderDir = Shader("../src/shaders/depthShaderDirectional.vs", "../src/shaders/depthShaderDirectional.fs");
-    _depthShaderPoint = Shader("../src/shaders/depthShaderPoint.vs", "../src/shaders/depthShaderPoint.fs", "../src/shaders/depthShaderPoint.gs");
-    _quadShader = Shader("../src/shaders/simpleQuad.vs", "../src/shaders/simpleQuad.fs");
-    _gBufferShader = Shader("../src/shaders/gBuffer.vs", "../src/shaders/gBuffer.fs");
-    _deferredShader = Shader("../src/shaders/objectDef.vs", "../src/shaders/objectDef.fs");
-    _hdrShader = Shader("../src/shaders/hdr.vs", "../src/shaders/hdr.fs");
-    _gaussianShader = Shader("../src/shaders/simpleQuad.vs", "../src/shaders/gaussian.fs");
-    _brightnessFilterShader = Shader("../src/shaders/simpleQuad.vs", "../src/shaders/brightFilter.fs");
-
-    _lightBoxShader = Shader("../src/shaders/lightBox.vs", "../src/shaders/lightBox.fs");
+    _objectShader = Shader("object.vs", "object.fs");
+    _depthShaderDir = Shader("depthShaderDirectional.vs", "depthShaderDirectional.fs");
+    _depthShaderPoint = Shader("depthShaderPoint.vs", "depthShaderPoint.fs", "depthShaderPoint.gs");
+    _quadPass.init("debug quad", "simpleQuad.fs", { "quadTexture" });
+    _quadPass.getShader();
+    _gBufferShaders = ShaderVariants("gBuffer.vs", "gBuffer.fs");
+    _deferredPass.init("deferred lighting", "objectDef.fs", { "gAlbedoSpec", "gNormal", "gPosition", "ssaoTexture" });
+    // The common variants, so they don't stall the first frames
+    _gBufferShaders.get();
+    _gBufferShaders.get({ { "NORMAL_MAP", "1" } });
+    _hdrPass.init("tonemap", "hdr.fs", { "colorBuffer", "bloomBlur" });
+    _hdrPass.getShader();
+    _gaussianPass.init("gaussian blur", "gaussian.fs", { "image" });
+    _gaussianPass.getShader();
+    _brightnessPass.init("brightness threshold", "brightFilter.fs", { "colorBuffer" });
+    _brightnessPass.getShader();
+
+    _lightBoxShader = Shader("lightBox.vs", "lightBox.fs");
+    _depthPrepassShader = Shader("depthPrepass.vs", "depthShaderDirectional.fs");
+    if (glExtensions.multiDrawIndirect) {
+        const ShaderDefines multiDraw = { { "MULTI_DRAW", "1" } };
+        _depthShaderDirMulti = Shader("depthShaderDirectional.vs", "depthShaderDirectional.fs", multiDraw);
+        _depthShaderPointMulti = Shader("depthShaderPoint.vs", "depthShaderPoint.fs", "depthShaderPoint.gs", multiDraw);
+        _depthPrepassShaderMulti = Shader("depthPrepass.vs", "depthShaderDirectional.fs", multiDraw);
+        _gBufferShaders.get(multiDraw);
+        _gBufferShaders.get({ { "MULTI_DRAW", "1" }, { "NORMAL_MAP", "1" } });
+        _indirectDraws.init();
+    }
+    glGenQueries(2, _overdrawQueries);
+
+    // Grows to fit the scene
+    _uploadRing.init(GL_UNIFORM_BUFFER, 64 * 1024);
 
     // Bloom renderer
     _bloomRenderer.init(_targetResolution.x, _targetResolution.y);
@@ -234,6 +292,17 @@ int Renderer::init() {
     // SSAO renderer
     _ssaoRenderer.init(_targetResolution);
 
+    // Hierarchical Z culling
+    _hiZRenderer.init(_targetResolution);
+    _boundsQueries.init();
+
+    shaderBatch.finish();
+    const Shader::CacheStats &shaderStats = Shader::getCacheStats();
+    float shaderSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - shadersStart).count();
+    std::cout << "Shader programs: " << shaderStats.hits << " from cache, " << shaderStats.misses << " compiled; "
+              << "submitted in " << shaderStats.submitSeconds * 1000.0f << "ms, waited " << shaderStats.waitSeconds * 1000.0f
+              << "ms, " << shaderSeconds * 1000.0f << "ms with the renderer's other setup" << std::endl;
+
     // Set default dirLight
     dirLight = shared_ptr<DirectionalLight>(new DirectionalLight(
         vec3(0.0f), 0.1f, 0.5f, 1.0f, vec3(0.0f), true
@@ -247,80 +316,501 @@ int Renderer::init() {
  * 
  */
 void Renderer::shaderConfigureLights(Shader &shader) {
-    int numberPointLights = pointLights.size();
+    int numberPointLights = _packet->pointLights.size();
     int textureNumber = 8;
 
     shader.use();
-    dirLight->bind(shader, textureNumber);
-    shader.setInt("numberPointLights", numberPointLights);
+    dirLight->bind(shader, textureNumber, _packet->dirLightDirection, _packet->dirLightSpaceMatrix);
     for (int i = 0; i < numberPointLights; i++) {
-        pointLights[i]->bind(shader, i, textureNumber);
+        const PointLightPacket &light = _packet->pointLights[i];
+        light.light->bind(shader, i, textureNumber, light.position);
     } 
 }
 
 /**
- * @brief Sets uniforms for shaders requiring access to the gBuffer.
- * 
+ * @brief Writes the frame's camera block and every draw item's object block into the
+ * upload ring, and binds the camera block.
  */
-void Renderer::shaderConfigureDeferred(Shader &shader) {
-    shader.use();
-    
-    // Load gBuffer textures
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, _gAlbedoSpec);
-    shader.setInt("gAlbedoSpec", 0);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, _gNormal);
-    shader.setInt("gNormal", 1);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, _gPosition);
-    shader.setInt("gPosition", 2);
+void Renderer::uploadFrameData() {
+    vector<vector<DrawItem>*> lists = { &_packet->deferred, &_packet->hizCulled, &_packet->forward, &_packet->dirLightCasters };
+    for (PointLightPacket &light : _packet->pointLights)
+        lists.push_back(&light.casters);
+
+    size_t itemCount = 0;
+    for (const vector<DrawItem> *items : lists)
+        itemCount += items->size();
+    _uploadRing.beginFrame(_uploadRing.align(sizeof(CameraBlock)) + itemCount * _uploadRing.align(sizeof(ObjectBlock)));
+
+    UploadAllocation camera = _uploadRing.allocate(sizeof(CameraBlock));
+    if (camera.data) {
+        CameraBlock *block = (CameraBlock*)camera.data;
+        block->view = _packet->view;
+        block->projection = _packet->projection;
+        block->viewPos = glm::vec4(_packet->cameraPosition, 1.0f);
+    }
 
-    shader.setVec3("viewPos", camera.position);
-    shader.setVec3("skyboxColor", _skyboxColor);
+    for (vector<DrawItem> *items : lists) {
+        for (DrawItem &item : *items) {
+            UploadAllocation object = _uploadRing.allocate(sizeof(ObjectBlock));
+            if (!object.data) continue;
+
+            ObjectBlock *block = (ObjectBlock*)object.data;
+            block->model = item.world;
+            for (int c = 0; c < 3; c++)
+                block->normalMatrix[c] = glm::vec4(item.normal[c], 0.0f);
+            item.uniformOffset = object.offset;
+        }
+    }
+    _uploadRing.unmap();
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BLOCK, _uploadRing.getBuffer(), camera.offset, sizeof(CameraBlock));
+
+    if (useMultiDraw()) recordMultiDraws();
+}
+
+bool Renderer::useMultiDraw() const {
+    return _multiDraw && glExtensions.multiDrawIndirect;
 }
 
 /**
- * @brief Renders all objects in the scene. 
- * 
- * This is not an external function! Shaders must be configured accordingly before calling.
+ * @brief Writes the frame's multi-draw passes: the shadow casters, and the G-buffer items
+ * not gated by an occlusion query, which are still drawn one by one.
+ *
+ * Shadow passes are only recorded while they aren't gated either. A point light's six
+ * faces are one pass, through the geometry shader.
+ *
+ * Each pass is also culled mesh by mesh against what it renders: the items are culled
+ * per object already, but their meshes may not all be in view.
  */
-void Renderer::renderAll(Shader &shader) {
-    shader.use();
-    for (auto i = objects.begin(); i != objects.end(); ++i) {
-        (*i)->draw(shader, *this);
+void Renderer::recordMultiDraws() {
+    unsigned int drawCount = 0;
+    auto countDraws = [&drawCount](const vector<DrawItem> &items, unsigned int end) {
+        for (unsigned int i = 0; i < end; i++)
+            drawCount += items[i].model->getMeshes().size();
+    };
+    countDraws(_packet->deferred, _packet->deferred.size());
+    countDraws(_packet->deferred, _packet->prepassCount);
+    countDraws(_packet->dirLightCasters, _packet->dirLightCasters.size());
+    for (const PointLightPacket &light : _packet->pointLights)
+        countDraws(light.casters, light.casters.size());
+    _indirectDraws.beginFrame(drawCount, 4 + _packet->pointLights.size());
+
+    if (!_queryGateShadows) {
+        CullView dirView;
+        dirView.viewProjections[0] = _packet->dirLightSpaceMatrix;
+        dirView.viewCount = 1;
+        const vector<DrawItem> &casters = _packet->dirLightCasters;
+        _dirLightDraws = _indirectDraws.record(casters, 0, casters.size(), false, true, nullptr, &dirView);
+
+        _pointLightDraws.clear();
+        for (const PointLightPacket &light : _packet->pointLights) {
+            CullView pointView;
+            for (const glm::mat4 &matrix : light.shadowMatrices)
+                pointView.viewProjections[pointView.viewCount++] = matrix;
+            pointView.origin = light.position;
+            pointView.maxDistance = light.light->getRange();
+            _pointLightDraws.push_back(_indirectDraws.record(light.casters, 0, light.casters.size(), false, true,
+                                                             nullptr, &pointView));
+        }
     }
+
+    const vector<DrawItem> &items = _packet->deferred;
+    const unsigned int prepassCount = _packet->prepassCount;
+    auto ungated = [this](const DrawItem &item) { return !hasQueryGate(item); };
+    CullView cameraView;
+    cameraView.viewProjections[0] = _packet->projection * _packet->view;
+    cameraView.viewCount = 1;
+    cameraView.origin = _packet->cameraPosition;
+    cameraView.maxDistance = _cullDistance;
+    _prepassDraws = _indirectDraws.record(items, 0, prepassCount, false, true, ungated, &cameraView);
+    _gBufferPrepassedDraws = _indirectDraws.record(items, 0, prepassCount, true, _useNormalMaps, ungated, &cameraView);
+    _gBufferDraws = _indirectDraws.record(items, prepassCount, items.size(), true, _useNormalMaps, ungated, &cameraView);
+    _indirectDraws.unmap();
+    _indirectDraws.cull();
 }
 
-void Renderer::renderShadowCasters(Shader &shader) {
-    shader.use();
-    for (auto i = objects.begin(); i != objects.end(); ++i) {
-        if (!(*i)->castsShadow) continue;
-        (*i)->draw(shader, *this);
+void Renderer::addObject(shared_ptr<GameObject> object) {
+    _objects.push_back(object);
+    SceneStore::instance().setFlag(object->getHandle(), SceneStore::ACTIVE, true);
+}
+
+void Renderer::removeObject(shared_ptr<GameObject> object) {
+    auto found = std::find(_objects.begin(), _objects.end(), object);
+    if (found == _objects.end()) return;
+
+    SceneStore::instance().setFlag(object->getHandle(), SceneStore::ACTIVE, false);
+    // The prepared frame may still draw it
+    _retiredObjects.push_back(object);
+    _objects.erase(found);
+}
+
+void Renderer::packMaterialTextures() {
+    SceneStore &scene = SceneStore::instance();
+    vector<shared_ptr<Material>> materials;
+    for (auto &object : _objects)
+        scene.getModel(scene.indexOf(object->getHandle()))->getMaterials(materials);
+
+    _textureArrays.pack(materials);
+
+    // Build the array variants now rather than on their first draw
+    ShaderBatch shaderBatch;
+    for (const shared_ptr<Material> &material : materials) {
+        if (material->isPacked()) _gBufferShaders.get(material->getDefines());
     }
 }
 
-void Renderer::renderDeferred(Shader &shader) {
-    shader.use();
-    for (auto i = objects.begin(); i != objects.end(); ++i) {
-        if (!(*i)->deferred) continue;
-        (*i)->draw(shader, *this);
+/**
+ * @brief Finds the object under the cursor, testing against its triangles.
+ *
+ * @param cursor Position in window coordinates, as given to the cursor callbacks.
+ * @return The nearest object hit, or null.
+ */
+shared_ptr<GameObject> Renderer::pick(glm::vec2 cursor) {
+    int width, height;
+    glfwGetWindowSize(_window, &width, &height);
+    if (width <= 0 || height <= 0) return nullptr;
+
+    // Ray through the cursor from the near to the far plane
+    glm::vec2 ndc(2.0f * cursor.x / width - 1.0f, 1.0f - 2.0f * cursor.y / height);
+    glm::mat4 inverseViewProjection = glm::inverse(camera.projection * camera.generateView());
+    glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndc, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndc, 1.0f, 1.0f);
+    glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    glm::vec3 direction = glm::vec3(farPoint) / farPoint.w - origin;
+
+    SceneStore &scene = SceneStore::instance();
+    vector<std::pair<float, uint32_t>> candidates;
+    _bvh.queryRay(origin, direction, 1.0f, candidates);
+
+    // Candidates are sorted by where the ray enters their bounds
+    float nearest = INFINITY;
+    uint32_t hit = ~0u;
+    for (const auto &candidate : candidates) {
+        if (candidate.first > nearest) break;
+        uint32_t i = candidate.second;
+        if (!(scene.getFlags(i) & SceneStore::ACTIVE)) continue;
+
+        // Intersect in model space, where distances are still multiples of `direction`
+        glm::mat4 inverseModel = glm::inverse(scene.getWorldMatrix(i));
+        float distance;
+        if (scene.getModel(i)->intersectRay(glm::vec3(inverseModel * glm::vec4(origin, 1.0f)), 
+                                            glm::vec3(inverseModel * glm::vec4(direction, 0.0f)), distance)
+            && distance < nearest) {
+            nearest = distance;
+            hit = i;
+        }
+    }
+    if (hit == ~0u) return nullptr;
+
+    for (auto &object : _objects) {
+        if (scene.indexOf(object->getHandle()) == hit) return object;
     }
+    return nullptr;
+}
+
+/**
+ * @brief Picks a level of detail from an object's projected size on screen.
+ *
+ * Each halving of the screen size drops one level, and shadow passes are biased towards
+ * coarser levels. A level only changes once the size moves `hysteresis` levels past the
+ * boundary, so objects near a threshold don't flicker between LODs.
+ */
+unsigned int Renderer::selectLod(SceneStore &scene, unsigned int index, RenderPass pass, const RenderPacket &packet) const {
+    unsigned int lodCount = scene.getModel(index)->getLodCount();
+    if (lodCount <= 1) return 0;
+
+    // Bounding sphere of the world space bounds
+    glm::vec3 boundsMin = scene.getWorldBoundsMin(index), boundsMax = scene.getWorldBoundsMax(index);
+    glm::vec3 center = 0.5f * (boundsMin + boundsMax);
+    float radius = 0.5f * glm::length(boundsMax - boundsMin);
+    float distance = std::max(glm::length(center - packet.cameraPosition), 0.001f);
+
+    // Projected radius as a fraction of half the screen height
+    float screenSize = std::max(radius * packet.projection[1][1] / distance, 0.0001f);
+
+    float level = std::log2(_lodScreenSize / screenSize);
+    if (pass == RenderPass::SHADOW)
+        level += _shadowLodBias;
+
+    unsigned int &current = scene.getLods(index)[(int)pass];
+    if (level >= current + 1.0f + _lodHysteresis || level < current - _lodHysteresis)
+        current = (unsigned int)glm::clamp(std::floor(level), 0.0f, (float)(lodCount - 1));
+
+    return current;
+}
+
+/**
+ * @brief Whether an object is heavy enough to be worth its own occlusion query. Not while
+ * the camera is close enough to its bounds for the near plane to clip them, since the
+ * clipped box could fail the query while the object is in view.
+ */
+bool Renderer::useOcclusionQuery(SceneStore &scene, unsigned int index, const RenderPacket &packet) const {
+    if (!_occlusionQueries || scene.getModel(index)->getTriangleCount() < _queryMinTriangles) return false;
+
+    const glm::mat4 &projection = packet.projection;
+    float nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+    // Covers the corners of the near plane too
+    glm::vec3 margin(2.0f * nearPlane / std::min(projection[0][0], projection[1][1]) + nearPlane);
+    glm::vec3 boundsMin = scene.getWorldBoundsMin(index) - margin, boundsMax = scene.getWorldBoundsMax(index) + margin;
+    return glm::any(glm::lessThan(packet.cameraPosition, boundsMin)) || glm::any(glm::greaterThan(packet.cameraPosition, boundsMax));
+}
+
+/**
+ * @brief Snapshots an object for drawing in a pass. `depth` orders items front to back.
+ */
+DrawItem Renderer::makeDrawItem(SceneStore &scene, unsigned int index, RenderPass pass, const RenderPacket &packet, 
+                                float depth) const {
+    // Non-negative floats sort the same as their bits
+    uint32_t depthBits;
+    float clampedDepth = std::max(depth, 0.0f);
+    memcpy(&depthBits, &clampedDepth, sizeof(depthBits));
+
+    return {
+        scene.getModel(index), scene.getWorldMatrix(index), scene.getNormalMatrix(index), 
+        selectLod(scene, index, pass, packet), scene.getWorldBoundsMin(index), scene.getWorldBoundsMax(index),
+        ((uint64_t)depthBits << 32) | index, 
+        useOcclusionQuery(scene, index, packet) ? scene.handleOf(index) : SceneHandle(),
+    };
+}
+
+/**
+ * @brief Builds the render packet for a frame. Runs as a job on the pool, while the GL
+ * thread submits the previous packet, so it must not touch GL.
+ */
+void Renderer::prepareFrame(RenderPacket &packet) {
+    // World transforms and bounds are cached for every pass this frame
+    SceneStore &scene = SceneStore::instance();
+    scene.update();
+    _bvh.update(scene);
+
+    packet.view = camera.generateView();
+    packet.projection = camera.projection;
+    packet.cameraPosition = camera.position;
+
+    auto byKey = [](const DrawItem &a, const DrawItem &b) { return a.sortKey < b.sortKey; };
+    auto centerOf = [&scene](unsigned int i) { return 0.5f * (scene.getWorldBoundsMin(i) + scene.getWorldBoundsMax(i)); };
+    const uint8_t casterFlags = SceneStore::ACTIVE | SceneStore::CASTS_SHADOW;
+
+    // Camera culling
+    _bvh.queryFrustum(Frustum::fromMatrix(packet.projection * packet.view), _visibleObjects);
+    packet.visibleCount = _visibleObjects.size();
+
+    // Occlusion culling - rasterize the visible occluders, then test everything else against
+    // them and against the last depth pyramid read back from the GPU
+    _occluded.assign(_visibleObjects.size(), VISIBLE);
+    bool cpuCulling = false;
+    if (_occlusionCulling) {
+        const uint8_t occluderFlags = SceneStore::ACTIVE | SceneStore::OCCLUDER;
+        _occlusionCuller.begin(packet.projection * packet.view);
+        for (uint32_t i : _visibleObjects) {
+            if ((scene.getFlags(i) & occluderFlags) == occluderFlags)
+                _occlusionCuller.addOccluder(scene.getModel(i)->getOccluderMesh(), scene.getWorldMatrix(i));
+        }
+
+        cpuCulling = _occlusionCuller.getStats().triangles > 0;
+        if (cpuCulling) _occlusionCuller.rasterize();
+    }
+    bool hizCulling = _hizCulling && _hizBuffer.valid();
+
+    if (cpuCulling || hizCulling) {
+        JobSystem::instance().parallelFor(_visibleObjects.size(), 64, [&](unsigned int begin, unsigned int end) {
+            for (unsigned int k = begin; k < end; k++) {
+                uint32_t i = _visibleObjects[k];
+                uint8_t flags = scene.getFlags(i);
+                const glm::vec3 &boundsMin = scene.getWorldBoundsMin(i), &boundsMax = scene.getWorldBoundsMax(i);
+                if (cpuCulling && !(flags & SceneStore::OCCLUDER) && !_occlusionCuller.isVisible(boundsMin, boundsMax))
+                    _occluded[k] = OCCLUDED;
+                else if (hizCulling && (flags & SceneStore::DEFERRED) && !_hizBuffer.isVisible(boundsMin, boundsMax))
+                    _occluded[k] = HIZ_CULLED;
+            }
+        });
+    }
+
+    packet.occludedCount = 0;
+    packet.deferred.clear();
+    packet.forward.clear();
+    packet.hizCulled.clear();
+    for (unsigned int k = 0; k < _visibleObjects.size(); k++) {
+        uint32_t i = _visibleObjects[k];
+        uint8_t flags = scene.getFlags(i);
+        if (!(flags & SceneStore::ACTIVE)) continue;
+        if (_occluded[k] == OCCLUDED) {
+            packet.occludedCount++;
+            continue;
+        }
+        if (_occluded[k] == HIZ_CULLED) {
+            packet.hizCulled.push_back(makeDrawItem(scene, i, RenderPass::GEOMETRY, packet, 0.0f));
+            continue;
+        }
+
+        float depth = -(packet.view * glm::vec4(centerOf(i), 1.0f)).z;
+        if (flags & SceneStore::DEFERRED)
+            packet.deferred.push_back(makeDrawItem(scene, i, RenderPass::GEOMETRY, packet, depth));
+        else
+            packet.forward.push_back(makeDrawItem(scene, i, RenderPass::FORWARD, packet, 0.0f));
+    }
+    std::sort(packet.deferred.begin(), packet.deferred.end(), byKey);
+
+    // Large objects and occluders go through the depth pre-pass, still front to back
+    packet.prepassCount = 0;
+    if (_prepassActive) {
+        for (DrawItem &item : packet.deferred) {
+            uint32_t i = item.sortKey & 0xffffffffu;
+            glm::vec3 center = 0.5f * (item.boundsMin + item.boundsMax);
+            float radius = 0.5f * glm::length(item.boundsMax - item.boundsMin);
+            float distance = std::max(glm::length(center - packet.cameraPosition), 0.001f);
+            float screenSize = radius * packet.projection[1][1] / distance;
+            item.depthPrepass = screenSize >= _prepassMinScreenSize || (scene.getFlags(i) & SceneStore::OCCLUDER);
+            packet.prepassCount += item.depthPrepass;
+        }
+        std::stable_partition(packet.deferred.begin(), packet.deferred.end(), [](const DrawItem &item) {
+            return item.depthPrepass;
+        });
+    }
+    // Forward objects keep scene order
+    std::sort(packet.forward.begin(), packet.forward.end(), byKey);
+
+    packet.queriedCount = 0;
+    for (const vector<DrawItem> *items : { &packet.deferred, &packet.hizCulled, &packet.forward }) {
+        for (const DrawItem &item : *items)
+            packet.queriedCount += item.query.index != ~0u;
+    }
+
+    // Directional light - casters inside its orthographic volume
+    packet.dirLightCasters.clear();
+    if (dirLight) {
+        packet.dirLightDirection = dirLight->direction;
+        packet.dirLightSpaceMatrix = dirLight->generateProjectionMatrix();
+        if (dirLight->getCastsShadow()) {
+            _bvh.queryFrustum(Frustum::fromMatrix(packet.dirLightSpaceMatrix), _lightObjects);
+            for (uint32_t i : _lightObjects) {
+                if ((scene.getFlags(i) & casterFlags) != casterFlags) continue;
+                // Light space z is in [-1, 1] for anything inside the volume
+                float depth = (packet.dirLightSpaceMatrix * glm::vec4(centerOf(i), 1.0f)).z + 1.0f;
+                packet.dirLightCasters.push_back(makeDrawItem(scene, i, RenderPass::SHADOW, packet, depth));
+            }
+            std::sort(packet.dirLightCasters.begin(), packet.dirLightCasters.end(), byKey);
+        }
+    }
+
+    // Point lights - only objects within range can cast into their shadow maps
+    packet.pointLights.resize(pointLights.size());
+    for (unsigned int l = 0; l < pointLights.size(); l++) {
+        PointLightPacket &light = packet.pointLights[l];
+        light.light = pointLights[l].get();
+        light.position = pointLights[l]->position;
+        light.shadowMatrices.clear();
+        light.casters.clear();
+        if (!light.light->getCastsShadow()) continue;
+
+        light.shadowMatrices = light.light->generateProjectionMatrices();
+        _bvh.querySphere(light.position, light.light->getRange(), _lightObjects);
+        for (uint32_t i : _lightObjects) {
+            if ((scene.getFlags(i) & casterFlags) != casterFlags) continue;
+            float depth = glm::length(centerOf(i) - light.position);
+            light.casters.push_back(makeDrawItem(scene, i, RenderPass::SHADOW, packet, depth));
+        }
+        std::sort(light.casters.begin(), light.casters.end(), byKey);
+    }
+}
+
+/**
+ * @brief Whether the item has a query from a previous frame to gate it on.
+ */
+bool Renderer::hasQueryGate(const DrawItem &item) const {
+    return item.query.index != ~0u && item.query.index < _queryGenerations.size()
+        && _queryGenerations[item.query.index] == item.query.generation;
+}
+
+/**
+ * @brief Starts conditional rendering on the object's query from the previous frame, if
+ * it has one and this pass is gated. Doesn't wait for the result, so an object whose result
+ * isn't in yet is drawn - except objects in the depth pre-pass, which must get the same
+ * answer in both passes or leave depth without G-buffer data behind.
+ *
+ * @return true if conditional rendering was started and must be ended after the draw.
+ */
+bool Renderer::beginQueryGate(const DrawItem &item) {
+    if (_currentPass == RenderPass::SHADOW && !_queryGateShadows) return false;
+    if (!hasQueryGate(item)) return false;
+
+    glBeginConditionalRender(_objectQueries.getQuery(item.query.index), item.depthPrepass ? GL_QUERY_WAIT : GL_QUERY_NO_WAIT);
+    return true;
+}
+
+/**
+ * @brief Queries the bounds of every object in `itemLists` with its own query against the
+ * bound depth buffer, for gating its draws next frame.
+ */
+void Renderer::issueObjectQueries(std::initializer_list<const vector<DrawItem>*> itemLists) {
+    if (_packet->queriedCount == 0) return;
+
+    bool begun = false;
+    for (const vector<DrawItem> *items : itemLists) {
+        for (const DrawItem &item : *items) {
+            if (item.query.index == ~0u) continue;
+            if (!begun) _objectQueries.begin(_packet->projection * _packet->view);
+            begun = true;
+            if (_queryGenerations.size() <= item.query.index) _queryGenerations.resize(item.query.index + 1, ~0u);
+
+            _objectQueries.query(item.query.index, item.boundsMin, item.boundsMax);
+            _queryGenerations[item.query.index] = item.query.generation;
+        }
+    }
+    if (begun) _objectQueries.end();
+}
+
+/**
+ * @brief Binds the item's object block and starts its occlusion query gate, if it has one.
+ * 
+ * @return true if conditional rendering must be ended after the draw.
+ */
+bool Renderer::beginItem(const DrawItem &item, bool gate) {
+    glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BLOCK, _uploadRing.getBuffer(), item.uniformOffset, sizeof(ObjectBlock));
+    return gate && beginQueryGate(item);
+}
+
+void Renderer::drawItem(Shader &shader, const DrawItem &item, bool gate) {
+    bool gated = beginItem(item, gate);
+    item.model->draw(shader, item.lod);
+    if (gated) glEndConditionalRender();
+}
+
+void Renderer::drawItem(ShaderVariants &variants, const DrawItem &item, bool gate) {
+    bool gated = beginItem(item, gate);
+    item.model->draw(variants, item.lod);
+    if (gated) glEndConditionalRender();
+}
+
+/**
+ * @brief Draws an item to the G-buffer, each mesh with the variant for its textures, or
+ * all with the plain variant when normal mapping is off.
+ */
+void Renderer::drawGBufferItem(const DrawItem &item, bool gate) {
+    if (_useNormalMaps) {
+        drawItem(_gBufferShaders, item, gate);
+    } else {
+        drawItem(_gBufferShaders.get(), item, gate);
+    }
+}
+
+void Renderer::drawItems(Shader &shader, const vector<DrawItem> &items) {
+    shader.use();
+    for (const DrawItem &item : items)
+        drawItem(shader, item);
 }
 
 void Renderer::renderForward(Shader &shader) {
     shader.use();
     int x = 0;
-    for (auto i = objects.begin(); i != objects.end(); ++i) {
-        if ((*i)->deferred) continue;
-
+    for (const DrawItem &item : _packet->forward) {
         // HACK temporary debug
         if (x++ == 0)
             _lightBoxShader.setVec3("lightColor", 10.0f, 0.0f, 0.0f); 
         else
             _lightBoxShader.setVec3("lightColor", 0.0f, 5.0f, 0.0f);
 
-        (*i)->draw(shader, *this);
+        drawItem(shader, item);
     }
 }
 
@@ -330,13 +820,9 @@ void Renderer::renderForward(Shader &shader) {
  * This is a debug tool, intended to be used to draw arbitrary textures to the screen.
  */
 void Renderer::renderQuad() {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, _quadTexture);
-
-    _quadShader.use();
-    _quadShader.setInt("quadTexture", 0);
-    _quad.draw();
+    _quadPass.begin(0, { _quadTexture });
+    _quadPass.draw();
+    _quadPass.end();
 }
 
 /**
@@ -349,10 +835,128 @@ void Renderer::renderGBuffer() {
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    _gBufferShader.use();
-    _gBufferShader.setBool("useNormalMaps", _useNormalMaps);
-    camera.configureShader(_gBufferShader);
-    renderDeferred(_gBufferShader);
+    _currentPass = RenderPass::GEOMETRY;
+    readOverdrawQueries();
+
+    const vector<DrawItem> &items = _packet->deferred;
+    const unsigned int prepassCount = _packet->prepassCount;
+    // With multi-draw, only items gated by a query are left to draw one by one
+    const bool multiDraw = useMultiDraw();
+    auto drawnAlone = [&](const DrawItem &item) { return !multiDraw || hasQueryGate(item); };
+
+    // Depth pre-pass, so the G-buffer pass only shades the nearest fragment of these
+    if (prepassCount > 0) {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glBeginQuery(GL_SAMPLES_PASSED, _overdrawQueries[0]);
+        if (multiDraw) {
+            _depthPrepassShaderMulti.use();
+            _indirectDraws.draw(_prepassDraws, _depthPrepassShaderMulti);
+        }
+        // Bound only if some item is left to draw alone
+        bool bound = false;
+        for (unsigned int i = 0; i < prepassCount; i++) {
+            if (!drawnAlone(items[i])) continue;
+            if (!bound) _depthPrepassShader.use();
+            bound = true;
+            drawItem(_depthPrepassShader, items[i]);
+        }
+        glEndQuery(GL_SAMPLES_PASSED);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+
+    glBeginQuery(GL_SAMPLES_PASSED, _overdrawQueries[1]);
+    if (prepassCount > 0) {
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+        if (multiDraw) _indirectDraws.draw(_gBufferPrepassedDraws, _gBufferShaders);
+        bool bound = false;
+        for (unsigned int i = 0; i < prepassCount; i++) {
+            if (!drawnAlone(items[i])) continue;
+            if (!bound) _gBufferShaders.get().use();
+            bound = true;
+            drawGBufferItem(items[i]);
+        }
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+    if (multiDraw) _indirectDraws.draw(_gBufferDraws, _gBufferShaders);
+    bool bound = false;
+    for (unsigned int i = prepassCount; i < items.size(); i++) {
+        if (!drawnAlone(items[i])) continue;
+        if (!bound) _gBufferShaders.get().use();
+        bound = true;
+        drawGBufferItem(items[i]);
+    }
+    glEndQuery(GL_SAMPLES_PASSED);
+    _overdrawQueried = true;
+    _prepassQueried = prepassCount > 0;
+
+    renderDisoccluded();
+    issueObjectQueries({ &_packet->deferred, &_packet->hizCulled });
+}
+
+/**
+ * @brief Reads last frame's overdraw, if the GPU has finished with it. Never waits.
+ */
+void Renderer::readOverdrawQueries() {
+    if (!_overdrawQueried) return;
+
+    unsigned int available = 0;
+    glGetQueryObjectuiv(_overdrawQueries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) return;
+
+    float pixels = (float)_targetResolution.x * _targetResolution.y;
+    unsigned int samples = 0;
+    glGetQueryObjectuiv(_overdrawQueries[1], GL_QUERY_RESULT, &samples);
+    _gBufferOverdraw = samples / pixels;
+    _prepassOverdraw = 0.0f;
+    if (_prepassQueried) {
+        // Issued before the G-buffer query, so it's finished too
+        glGetQueryObjectuiv(_overdrawQueries[0], GL_QUERY_RESULT, &samples);
+        _prepassOverdraw = samples / pixels;
+    }
+}
+
+/**
+ * @brief Second pass of hierarchical Z culling. Objects the old pyramid rejected are
+ * tested again against this frame's depth, by occlusion queries on their bounds, and drawn
+ * with conditional rendering so the result never comes back to the CPU.
+ *
+ * Also collects last frame's query results, which count the false negatives.
+ */
+void Renderer::renderDisoccluded() {
+    if (_hizQueryCount > 0) {
+        unsigned int disoccluded = 0;
+        bool complete = true;
+        for (unsigned int i = 0; i < _hizQueryCount && complete; i++) {
+            bool visible;
+            complete = _boundsQueries.getResult(i, visible);
+            disoccluded += complete && visible;
+        }
+        if (complete) {
+            _hizCulledCount = _hizQueryCount;
+            _hizDisoccludedCount = disoccluded;
+        }
+    } else {
+        _hizCulledCount = _hizDisoccludedCount = 0;
+    }
+
+    const vector<DrawItem> &items = _packet->hizCulled;
+    _hizQueryCount = items.size();
+    if (items.empty()) return;
+
+    _boundsQueries.begin(_packet->projection * _packet->view);
+    for (unsigned int i = 0; i < items.size(); i++)
+        _boundsQueries.query(i, items[i].boundsMin, items[i].boundsMax);
+    _boundsQueries.end();
+
+    _gBufferShaders.get().use();
+    for (unsigned int i = 0; i < items.size(); i++) {
+        glBeginConditionalRender(_boundsQueries.getQuery(i), GL_QUERY_WAIT);
+        // Conditional rendering doesn't nest
+        drawGBufferItem(items[i], false);
+        glEndConditionalRender();
+    }
 }
 
 /**
@@ -364,8 +968,14 @@ void Renderer::renderGBuffer() {
  */
 void Renderer::generateDepthMap(shared_ptr<DirectionalLight> light) {
     if (light->getCastsShadow()) {
-        light->configureForDepthMap(_depthShaderDir, _depthMapFBO);
-        renderShadowCasters(_depthShaderDir);
+        _currentPass = RenderPass::SHADOW;
+        if (useMultiDraw() && !_queryGateShadows) {
+            light->configureForDepthMap(_depthShaderDirMulti, _depthMapFBO, _packet->dirLightSpaceMatrix);
+            _indirectDraws.draw(_dirLightDraws, _depthShaderDirMulti);
+        } else {
+            light->configureForDepthMap(_depthShaderDir, _depthMapFBO, _packet->dirLightSpaceMatrix);
+            drawItems(_depthShaderDir, _packet->dirLightCasters);
+        }
     }
 
     glViewport(0, 0, _targetResolution.x, _targetResolution.y);
@@ -374,14 +984,19 @@ void Renderer::generateDepthMap(shared_ptr<DirectionalLight> light) {
 /**
  * @brief Generates the depth map for a point light. 
  * 
- * @param light 
- * @param framebuf 
- * @param texture 
+ * @param light The light's state in the current packet
+ * @param index The light's index in the packet
  */
-void Renderer::generateDepthMap(shared_ptr<PointLight> light) {
-    if (light->getCastsShadow()) {
-        light->configureForDepthMap(_depthShaderPoint, _depthMapFBO);
-        renderShadowCasters(_depthShaderPoint);
+void Renderer::generateDepthMap(const PointLightPacket &light, unsigned int index) {
+    if (light.light->getCastsShadow()) {
+        _currentPass = RenderPass::SHADOW;
+        if (useMultiDraw() && !_queryGateShadows) {
+            light.light->configureForDepthMap(_depthShaderPointMulti, _depthMapFBO, light.position, light.shadowMatrices);
+            _indirectDraws.draw(_pointLightDraws[index], _depthShaderPointMulti);
+        } else {
+            light.light->configureForDepthMap(_depthShaderPoint, _depthMapFBO, light.position, light.shadowMatrices);
+            drawItems(_depthShaderPoint, light.casters);
+        }
     }
 
     glViewport(0, 0, _targetResolution.x, _targetResolution.y);
@@ -392,15 +1007,24 @@ void Renderer::generateDepthMap(shared_ptr<PointLight> light) {
  * 
  */
 void Renderer::drawDeferred() {
-    glBindFramebuffer(GL_FRAMEBUFFER, _hdrBuffer);
+    // The variant for this light setup, with the shadow tests resolved at compile time
+    unsigned int pointShadows = 0;
+    for (unsigned int i = 0; i < _packet->pointLights.size(); i++) {
+        if (_packet->pointLights[i].light->getCastsShadow()) pointShadows |= 1u << i;
+    }
+    Shader &shader = _deferredPass.begin(_hdrBuffer, { _gAlbedoSpec, _gNormal, _gPosition, _ssaoRenderer.getTexture() }, {
+        { "DIR_LIGHT_SHADOW", dirLight->getCastsShadow() ? "1" : "0" },
+        { "NR_POINT_LIGHTS", std::to_string(_packet->pointLights.size()) },
+        { "POINT_LIGHT_SHADOWS", std::to_string(pointShadows) },
+    });
     glClear(GL_DEPTH_BUFFER_BIT); // Clear depth buffer - colour buffer will be overwritten
+
+    shader.setVec3("viewPos", _packet->cameraPosition);
+    shader.setVec3("skyboxColor", _skyboxColor);
+    shaderConfigureLights(shader);
     
-    // Configure shaders
-    shaderConfigureDeferred(_deferredShader);
-    shaderConfigureLights(_deferredShader);
-    
-    // Draw onto quad
-    _quad.draw(); 
+    _deferredPass.draw();
+    _deferredPass.end();
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
@@ -416,8 +1040,12 @@ void Renderer::drawForward() {
     glBlitFramebuffer(0, 0, _targetResolution.x, _targetResolution.y, 0, 0, _targetResolution.x, _targetResolution.y, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
     glBindFramebuffer(GL_FRAMEBUFFER, _hdrBuffer);
 
+    _currentPass = RenderPass::FORWARD;
+    // Against the deferred depth just copied, before forward objects write their own
+    issueObjectQueries({ &_packet->forward });
+
     // temp debug
-    camera.configureShader(_lightBoxShader);
+    _lightBoxShader.use();
     _lightBoxShader.setVec3("lightColor", glm::vec3(1.0f, 0.0f, 0.0f));
 
     renderForward(_lightBoxShader);
@@ -432,15 +1060,9 @@ void Renderer::drawForward() {
  * @param outFBO FBO with an attached color buffer in location 0 of the same size as inTexture.
  */
 void Renderer::brightnessThreshold(unsigned int inTexture, unsigned int outFBO) {
-    glBindFramebuffer(GL_FRAMEBUFFER, outFBO);
-
-    _brightnessFilterShader.use();
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, inTexture);
-    _brightnessFilterShader.setInt("colorBuffer", 0);
-    
-    // Draw
-    _quad.draw();
+    _brightnessPass.begin(outFBO, { inTexture });
+    _brightnessPass.draw();
+    _brightnessPass.end();
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
@@ -450,19 +1072,50 @@ void Renderer::brightnessThreshold(unsigned int inTexture, unsigned int outFBO)
  * This is the entry point for rendering. It should be called once per render loop.
  */
 void Renderer::draw() {
+    // The first frame has nothing prepared yet
+    if (!_packet) {
+        _framePrep.kick([this](RenderPacket &packet) { prepareFrame(packet); });
+        _packet = &_framePrep.wait();
+    }
+
+    // With the pre-pass on, the G-buffer overdraw no longer shows what it would be without it
+    switch (_depthPrepassMode) {
+        case DepthPrepassMode::OFF: _prepassActive = false; break;
+        case DepthPrepassMode::ON: _prepassActive = true; break;
+        case DepthPrepassMode::AUTO: {
+            float overdraw = _prepassActive ? std::max(_prepassOverdraw, _gBufferOverdraw) : _gBufferOverdraw;
+            if (overdraw > _prepassEnableOverdraw) _prepassActive = true;
+            else if (overdraw < _prepassDisableOverdraw) _prepassActive = false;
+            break;
+        }
+    }
+
+    // The newest depth pyramid readback, for culling the next frame
+    if (_hizCulling)
+        _hiZRenderer.collect(_hizBuffer);
+    else
+        _hizBuffer.depth.clear();
+
+    // Prepare the next frame on the worker while this one is submitted
+    _framePrep.kick([this](RenderPacket &packet) { prepareFrame(packet); });
+
+    uploadFrameData();
+
     // Directional light depth map 
     generateDepthMap(dirLight);
 
     // Point light depth maps 
-    for (int i = 0; i < pointLights.size(); i++) {
-        generateDepthMap(pointLights[i]);
+    for (unsigned int i = 0; i < _packet->pointLights.size(); i++) {
+        generateDepthMap(_packet->pointLights[i], i);
     }
 
     // gBuffer
     renderGBuffer();
+    if (_hizCulling)
+        _hiZRenderer.build(_gDepth, _packet->projection * _packet->view);
 
     // Generate SSAO
-    _ssaoRenderer.draw(_gPosition, _gNormal, camera.projection, camera.generateView());
+    _ssaoRenderer.draw(_gPosition, _gNormal, _packet->projection, _packet->view);
 
     // Visible render pass
     drawDeferred();
@@ -480,44 +1133,27 @@ void Renderer::draw() {
 #if 0 
     bool horizontal = true, first_iteration = true;
     int amount = 20;
-    _gaussianShader.use();
-    glActiveTexture(GL_TEXTURE0);
-    _gaussianShader.setInt("image", 0);
+    Shader &gaussianShader = _gaussianPass.begin(_pingpongFBO[horizontal], { _brightBuffer });
     for (unsigned int i = 0; i < amount; i++)
     {
         glBindFramebuffer(GL_FRAMEBUFFER, _pingpongFBO[horizontal]); 
-        _gaussianShader.setInt("horizontal", horizontal);
-        glBindTexture(
-            GL_TEXTURE_2D, first_iteration ? _brightBuffer : _pingpongBuffers[!horizontal]
-        ); 
-        
-        // draw to quad
-        glBindVertexArray(_quadVAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        gaussianShader.setInt("horizontal", horizontal);
+        _gaussianPass.setInput(0, first_iteration ? _brightBuffer : _pingpongBuffers[!horizontal]);
+        _gaussianPass.draw();
 
         horizontal = !horizontal;
         if (first_iteration)
             first_iteration = false;
     }
+    _gaussianPass.end();
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 #endif
 
-    // Draw HDR buffer onto quad
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // Tonemap the HDR buffer to the screen
+    _hdrPass.begin(0, { _hdrColorBuffer, _bloomRenderer.bloomTexture() });
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); 
-    _hdrShader.use();
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, _hdrColorBuffer);
-    _hdrShader.setInt("colorBuffer", 0);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, _bloomRenderer.bloomTexture());
-    _hdrShader.setInt("bloomBlur", 1);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, _ssaoRenderer.getTexture());
-    _hdrShader.setInt("ssaoTexture", 2);
-
-    _quad.draw();
+    _hdrPass.draw();
+    _hdrPass.end();
 
 #if 0
     // _quadTexture = _pingpongBuffers[0];
@@ -526,7 +1162,14 @@ void Renderer::draw() {
     renderQuad();
 #endif
 
+    _uploadRing.endFrame();
+    if (useMultiDraw()) _indirectDraws.endFrame();
     glfwSwapBuffers(_window);
+
+    // The scene, camera and lights can change once the next frame has been prepared
+    _packet = &_framePrep.wait();
+    _retiredObjects.clear();
+
     glfwPollEvents();    
 }
 
@@ -10,8 +10,25 @@
 #include "pointLight.h"
 #include "gameObject.h"
 #include "bloomRenderer.h"
-#include "screenQuad.h"
+#include "fullscreenPass.h"
 #include "ssaoRenderer.h"
+#include "sceneBvh.h"
+#include "framePrep.h"
+#include "occlusionCuller.h"
+#include "hiZRenderer.h"
+#include "boundsQueries.h"
+#include "uploadRing.h"
+#include "uniformBlocks.h"
+#include "shaderVariants.h"
+#include "textureArrays.h"
+#include "indirectDraws.h"
+
+enum class DepthPrepassMode {
+    OFF,
+    ON,
+    // On while the measured overdraw is high enough to pay for it
+    AUTO,
+};
 
 class Renderer {
 private:
@@ -20,6 +37,33 @@ private:
     // Configuration (mutable)
     glm::vec3 _skyboxColor;
     bool _useNormalMaps { true };
+    // Screen size (fraction of half the screen height) at which objects use LOD 0
+    float _lodScreenSize { 0.5f };
+    // Extra LOD levels applied in shadow passes
+    float _shadowLodBias { 1.0f };
+    float _lodHysteresis { 0.15f };
+    // Submit passes with multi-draw indirect, where supported
+    bool _multiDraw { true };
+    // Multi-draw meshes further than this from the camera are culled, unless it is 0
+    float _cullDistance { 0.0f };
+    // Cull objects hidden behind occluders on the CPU
+    bool _occlusionCulling { true };
+    // Cull deferred objects against the previous frames' depth
+    bool _hizCulling { false };
+    // Gate heavy objects on their own occlusion query from the previous frame
+    bool _occlusionQueries { false };
+    unsigned int _queryMinTriangles { 20000 };
+    // Hidden from the camera doesn't mean the shadow is, so shadow passes aren't gated by default
+    bool _queryGateShadows { false };
+    // Depth-only pass ahead of the G-buffer, so each pixel is shaded once
+    DepthPrepassMode _depthPrepassMode { DepthPrepassMode::AUTO };
+    // Objects smaller than this on screen (as for LODs) skip the pre-pass; occluders never do
+    float _prepassMinScreenSize { 0.1f };
+    // AUTO turns the pre-pass on above the first overdraw and off below the second
+    float _prepassEnableOverdraw { 1.6f };
+    float _prepassDisableOverdraw { 1.3f };
+
+    RenderPass _currentPass { RenderPass::GEOMETRY };
 
     GLFWwindow *_window;
     glm::ivec2 _targetResolution;
@@ -38,21 +82,31 @@ private:
     unsigned int _brightFBO, _brightBuffer;
     unsigned int _pingpongFBO[2], _pingpongBuffers[2];
 
+    // Depth pre-pass
+    Shader _depthPrepassShader;
+    bool _prepassActive { false };
+    // Samples passed in the pre-pass and the G-buffer pass, read back a frame late
+    unsigned int _overdrawQueries[2];
+    bool _overdrawQueried { false };
+    bool _prepassQueried { false };
+    float _prepassOverdraw { 0.0f };
+    float _gBufferOverdraw { 0.0f };
+
     // Forward rendering mesh shader - legacy
     Shader _objectShader;
     // For rendering depth map for directional light
     Shader _depthShaderDir;
     // For rendering depth map for point light
     Shader _depthShaderPoint;
-    // For rendering gBuffer (deferred render)
-    Shader _gBufferShader;
-    // For drawing and lighting gBuffer (deferred render)
-    Shader _deferredShader;
-    // For drawing HDR buffer to screen quad with tonemapping
-    Shader _hdrShader;
+    // For rendering gBuffer (deferred render), by the mesh's textures
+    ShaderVariants _gBufferShaders;
+    // For drawing and lighting gBuffer (deferred render), by the light setup
+    FullscreenPass _deferredPass;
+    // For drawing HDR buffer to the screen with tonemapping
+    FullscreenPass _hdrPass;
     // Postprocessing
-    Shader _gaussianShader;
-    Shader _brightnessFilterShader;
+    FullscreenPass _gaussianPass;
+    FullscreenPass _brightnessPass;
 
     // temp debug    
     Shader _lightBoxShader;
@@ -63,31 +117,94 @@ private:
     // SSAO
     SSAORenderer _ssaoRenderer;
 
+    // Hierarchical Z culling
+    HiZRenderer _hiZRenderer;
+    BoundsQueries _boundsQueries;
+    // Read by the prep job, updated between preps
+    HiZBuffer _hizBuffer;
+    // Queries issued last frame, and what they found
+    unsigned int _hizQueryCount { 0 };
+    unsigned int _hizCulledCount { 0 };
+    unsigned int _hizDisoccludedCount { 0 };
+
+    // Per object occlusion queries, with slots indexed by scene handle
+    BoundsQueries _objectQueries;
+    // Generation of the object each slot was last queried for, ~0 if none
+    vector<uint32_t> _queryGenerations;
+
     // Debug
-    ScreenQuad _quad;
     unsigned int _quadTexture;
-    Shader _quadShader;
+    FullscreenPass _quadPass;
+
+    // Per frame uniform blocks
+    UploadRing _uploadRing;
+
+    // Multi-draw path, with the MULTI_DRAW builds of the untextured mesh shaders
+    IndirectDraws _indirectDraws;
+    Shader _depthShaderDirMulti;
+    Shader _depthShaderPointMulti;
+    Shader _depthPrepassShaderMulti;
+    // This frame's recorded passes. Point light passes are by light; the G-buffer has
+    // the items in the pre-pass and the rest separately, as they use different depth tests.
+    unsigned int _dirLightDraws { 0 };
+    vector<unsigned int> _pointLightDraws;
+    unsigned int _prepassDraws { 0 };
+    unsigned int _gBufferPrepassedDraws { 0 };
+    unsigned int _gBufferDraws { 0 };
+
+    // Material textures, once packed
+    TextureArrays _textureArrays;
+
+    // Keeps added objects alive; they are drawn from the SceneStore
+    std::vector<std::shared_ptr<GameObject>> _objects;
+    // Removed objects, kept alive until the frame prepared before their removal is submitted
+    std::vector<std::shared_ptr<GameObject>> _retiredObjects;
+
+    // Frame preparation - the BVH and scratch lists are only used by the prep job
+    FramePrep _framePrep;
+    // The packet being submitted
+    RenderPacket *_packet { nullptr };
+    SceneBVH _bvh;
+    vector<uint32_t> _visibleObjects;
+    vector<uint32_t> _lightObjects;
+    OcclusionCuller _occlusionCuller;
+    vector<uint8_t> _occluded;
 
 public:
     Camera camera;
-    std::vector<std::shared_ptr<GameObject>> objects;
     std::shared_ptr<DirectionalLight> dirLight;
     std::vector<std::shared_ptr<PointLight>> pointLights;
 
 private:
     void shaderConfigureLights(Shader &shader);
-    void shaderConfigureDeferred(Shader &shader);
     
-    void renderAll(Shader &shader);
-    void renderShadowCasters(Shader &shader);
-    void renderDeferred(Shader &shader);
+    void uploadFrameData();
+
+    // Frame preparation
+    unsigned int selectLod(SceneStore &scene, unsigned int index, RenderPass pass, const RenderPacket &packet) const;
+    bool useOcclusionQuery(SceneStore &scene, unsigned int index, const RenderPacket &packet) const;
+    DrawItem makeDrawItem(SceneStore &scene, unsigned int index, RenderPass pass, const RenderPacket &packet, float depth) const;
+    void prepareFrame(RenderPacket &packet);
+
+    bool hasQueryGate(const DrawItem &item) const;
+    bool beginQueryGate(const DrawItem &item);
+    bool useMultiDraw() const;
+    void recordMultiDraws();
+    void issueObjectQueries(std::initializer_list<const vector<DrawItem>*> itemLists);
+    bool beginItem(const DrawItem &item, bool gate);
+    void drawItem(Shader &shader, const DrawItem &item, bool gate = true);
+    void drawItem(ShaderVariants &variants, const DrawItem &item, bool gate = true);
+    void drawGBufferItem(const DrawItem &item, bool gate = true);
+    void drawItems(Shader &shader, const vector<DrawItem> &items);
     void renderForward(Shader &shader);
     void renderGBuffer();
+    void renderDisoccluded();
+    void readOverdrawQueries();
 
     void brightnessThreshold(unsigned int inTexture, unsigned int outFBO);
 
     void generateDepthMap(std::shared_ptr<DirectionalLight> light);
-    void generateDepthMap(std::shared_ptr<PointLight> light);
+    void generateDepthMap(const PointLightPacket &light, unsigned int index);
     
     void drawDeferred();
     void drawForward();
@@ -102,6 +219,16 @@ public:
     int init();
     void draw();
 
+    void addObject(std::shared_ptr<GameObject> object);
+    void removeObject(std::shared_ptr<GameObject> object);
+    /**
+     * @brief Packs the textures of the added objects' materials into texture arrays, so the
+     * G-buffer pass draws them without rebinding textures. Optional; call once the scene
+     * is loaded, and again after adding objects with new materials.
+     */
+    void packMaterialTextures();
+    std::shared_ptr<GameObject> pick(glm::vec2 cursor);
+
     bool shouldClose();
     
     // Callbacks
@@ -112,6 +239,62 @@ public:
     void setSkyboxColor(glm::vec3 value) { _skyboxColor = value; }
     GLFWwindow* getWindow() { return _window; }
     void setUseNormalMaps(bool val) { _useNormalMaps = val; }
+    void setSSAOSampleCount(unsigned int count) { _ssaoRenderer.setSampleCount(count); }
+    void setLodScreenSize(float val) { _lodScreenSize = val; }
+    float getLodScreenSize() const { return _lodScreenSize; }
+    void setShadowLodBias(float val) { _shadowLodBias = val; }
+    float getShadowLodBias() const { return _shadowLodBias; }
+    void setLodHysteresis(float val) { _lodHysteresis = val; }
+    float getLodHysteresis() const { return _lodHysteresis; }
+    RenderPass getCurrentPass() const { return _currentPass; }
+    const SceneBVH& getBVH() const { return _bvh; }
+    unsigned int getVisibleCount() const { return _packet ? _packet->visibleCount : 0; }
+    void setOcclusionCulling(bool val) { _occlusionCulling = val; }
+    bool getOcclusionCulling() const { return _occlusionCulling; }
+    unsigned int getOccludedCount() const { return _packet ? _packet->occludedCount : 0; }
+    void setHiZCulling(bool val) { _hizCulling = val; }
+    bool getHiZCulling() const { return _hizCulling; }
+    // Objects the last frame's depth pyramid kept out of the G-buffer
+    unsigned int getHiZCulledCount() const { return _hizCulledCount - _hizDisoccludedCount; }
+    // Fraction of the objects the pyramid rejected which turned out to be visible
+    float getHiZFalseNegativeRate() const { return _hizCulledCount ? (float)_hizDisoccludedCount / _hizCulledCount : 0.0f; }
+    void setOcclusionQueries(bool val) { _occlusionQueries = val; }
+    bool getOcclusionQueries() const { return _occlusionQueries; }
+    void setQueryMinTriangles(unsigned int val) { _queryMinTriangles = val; }
+    unsigned int getQueryMinTriangles() const { return _queryMinTriangles; }
+    void setQueryGateShadows(bool val) { _queryGateShadows = val; }
+    bool getQueryGateShadows() const { return _queryGateShadows; }
+    unsigned int getQueriedCount() const { return _packet ? _packet->queriedCount : 0; }
+    void setDepthPrepassMode(DepthPrepassMode val) { _depthPrepassMode = val; }
+    DepthPrepassMode getDepthPrepassMode() const { return _depthPrepassMode; }
+    void setPrepassMinScreenSize(float val) { _prepassMinScreenSize = val; }
+    float getPrepassMinScreenSize() const { return _prepassMinScreenSize; }
+    void setPrepassOverdrawThresholds(float enable, float disable) { _prepassEnableOverdraw = enable; _prepassDisableOverdraw = disable; }
+    bool getDepthPrepassActive() const { return _prepassActive; }
+    // Fragments per pixel written by the G-buffer pass - close to 1 with the pre-pass on
+    float getGBufferOverdraw() const { return _gBufferOverdraw; }
+    // Fragments per pixel passing the depth test in the pre-pass, 0 with it off
+    float getPrepassOverdraw() const { return _prepassOverdraw; }
+    // GPU milliseconds of each fullscreen pass, by name, a few frames behind
+    const std::map<string, float>& getPassTimings() const { return FullscreenPass::getTimings(); }
+    // Frames whose uniform uploads had to wait for the GPU
+    unsigned int getUploadStallCount() const { return _uploadRing.getStallCount(); }
+    // Falls back to a draw per mesh where multi-draw indirect isn't supported
+    void setMultiDraw(bool val) { _multiDraw = val; }
+    bool getMultiDraw() const { return _multiDraw; }
+    // Multi-draw calls and the mesh draws they made last frame
+    unsigned int getMultiDrawBatchCount() const { return useMultiDraw() ? _indirectDraws.getBatchCount() : 0; }
+    unsigned int getMultiDrawCount() const { return useMultiDraw() ? _indirectDraws.getDrawCount() : 0; }
+    // Distance culling of multi-draw meshes in the camera passes, off at 0
+    void setCullDistance(float val) { _cullDistance = val; }
+    float getCullDistance() const { return _cullDistance; }
+    // Whether multi-draw meshes are culled in a compute shader rather than while recording
+    bool getGPUCulling() const { return useMultiDraw() && _indirectDraws.getGPUCulling(); }
+    // Mesh draws culled last frame; with GPU culling only known while validating
+    unsigned int getCulledMeshCount() const { return useMultiDraw() ? _indirectDraws.getCulledCount() : 0; }
+    // Checks the GPU culling against the CPU every frame, reading it back
+    void setCullingValidation(bool val) { _indirectDraws.setValidation(val); }
+    unsigned int getCullingMismatchCount() const { return _indirectDraws.getValidationMismatches(); }
 
     // Debug
     void debugConfiguration();
@@ -0,0 +1,340 @@
+#include "sceneBvh.h"
+
+#include <algorithm>
+
+namespace {
+
+const uint32_t NONE = ~0u;
+const unsigned int BIN_COUNT = 12;
+// Leaves are always made at or below this size, and may be up to MAX_LEAF_SIZE when SAH prefers it
+const uint32_t MIN_LEAF_SIZE = 2;
+const uint32_t MAX_LEAF_SIZE = 8;
+// Rebuild once refitting has made the tree this much worse than when it was built...
+const float REBUILD_COST_RATIO = 1.5f;
+// ...or after this many frames of refitting
+const unsigned int REBUILD_INTERVAL = 600;
+
+float surfaceArea(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) {
+    glm::vec3 d = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+bool sphereHitsBox(const glm::vec3 &center, float radiusSquared, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) {
+    glm::vec3 offset = glm::clamp(center, boundsMin, boundsMax) - center;
+    return glm::dot(offset, offset) <= radiusSquared;
+}
+
+bool rayHitsBox(const glm::vec3 &origin, const glm::vec3 &inverseDirection, float maxDistance,
+                const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, float &entry) {
+    glm::vec3 t0 = (boundsMin - origin) * inverseDirection;
+    glm::vec3 t1 = (boundsMax - origin) * inverseDirection;
+    glm::vec3 near = glm::min(t0, t1), far = glm::max(t0, t1);
+    entry = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+    float exit = std::min(std::min(far.x, far.y), std::min(far.z, maxDistance));
+    return entry <= exit;
+}
+
+}
+
+Frustum Frustum::fromMatrix(const glm::mat4 &m)
+{
+    // Gribb & Hartmann: each plane is the last row plus or minus another row
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0];
+    frustum.planes[1] = rows[3] - rows[0];
+    frustum.planes[2] = rows[3] + rows[1];
+    frustum.planes[3] = rows[3] - rows[1];
+    frustum.planes[4] = rows[3] + rows[2];
+    frustum.planes[5] = rows[3] - rows[2];
+    for (glm::vec4 &plane : frustum.planes)
+        plane /= glm::length(glm::vec3(plane));
+    return frustum;
+}
+
+bool Frustum::intersects(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) const
+{
+    for (const glm::vec4 &plane : planes) {
+        // The corner furthest along the plane normal
+        glm::vec3 corner(plane.x >= 0.0f ? boundsMax.x : boundsMin.x,
+                         plane.y >= 0.0f ? boundsMax.y : boundsMin.y,
+                         plane.z >= 0.0f ? boundsMax.z : boundsMin.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) return false;
+    }
+    return true;
+}
+
+void SceneBVH::update(const SceneStore &scene)
+{
+    if (scene.getStructureVersion() != _structureVersion) {
+        rebuild(scene);
+        return;
+    }
+    if (scene.getUpdated().empty()) return;
+
+    refit(scene);
+    _refitsSinceBuild++;
+    if (_refitsSinceBuild >= REBUILD_INTERVAL || getCost() > _builtCost * REBUILD_COST_RATIO)
+        rebuild(scene);
+}
+
+void SceneBVH::rebuild(const SceneStore &scene)
+{
+    unsigned int count = scene.size();
+    _structureVersion = scene.getStructureVersion();
+    _refitsSinceBuild = 0;
+
+    _nodes.clear();
+    _primitives.resize(count);
+    _leafOf.assign(count, NONE);
+    _centroids.resize(count);
+    _boundsMin.resize(count);
+    _boundsMax.resize(count);
+    for (unsigned int i = 0; i < count; i++) {
+        _primitives[i] = i;
+        _boundsMin[i] = scene.getWorldBoundsMin(i);
+        _boundsMax[i] = scene.getWorldBoundsMax(i);
+        _centroids[i] = 0.5f * (_boundsMin[i] + _boundsMax[i]);
+    }
+
+    if (count == 0) {
+        _builtCost = 0.0f;
+        return;
+    }
+
+    _nodes.reserve(2 * count);
+    _nodes.push_back({ glm::vec3(0.0f), glm::vec3(0.0f), 0, count, NONE });
+    buildNode(0, 0, count);
+    _builtCost = getCost();
+}
+
+void SceneBVH::buildNode(uint32_t node, uint32_t first, uint32_t count)
+{
+    glm::vec3 boundsMin = _boundsMin[_primitives[first]], boundsMax = _boundsMax[_primitives[first]];
+    glm::vec3 centroidMin = _centroids[_primitives[first]], centroidMax = centroidMin;
+    for (uint32_t i = first; i < first + count; i++) {
+        uint32_t p = _primitives[i];
+        boundsMin = glm::min(boundsMin, _boundsMin[p]);
+        boundsMax = glm::max(boundsMax, _boundsMax[p]);
+        centroidMin = glm::min(centroidMin, _centroids[p]);
+        centroidMax = glm::max(centroidMax, _centroids[p]);
+    }
+    _nodes[node].boundsMin = boundsMin;
+    _nodes[node].boundsMax = boundsMax;
+
+    auto makeLeaf = [&]() {
+        _nodes[node].first = first;
+        _nodes[node].count = count;
+        for (uint32_t i = first; i < first + count; i++) _leafOf[_primitives[i]] = node;
+    };
+    if (count <= MIN_LEAF_SIZE) {
+        makeLeaf();
+        return;
+    }
+
+    // Binned SAH over the centroids, on every axis
+    float nodeArea = std::max(surfaceArea(boundsMin, boundsMax), 1e-12f);
+    float bestCost = INFINITY;
+    int bestAxis = -1;
+    unsigned int bestSplit = 0;
+    glm::vec3 extent = centroidMax - centroidMin;
+
+    for (int axis = 0; axis < 3; axis++) {
+        if (extent[axis] <= 0.0f) continue;
+
+        unsigned int binCounts[BIN_COUNT] {};
+        glm::vec3 binMin[BIN_COUNT], binMax[BIN_COUNT];
+        for (unsigned int b = 0; b < BIN_COUNT; b++) {
+            binMin[b] = glm::vec3(INFINITY);
+            binMax[b] = glm::vec3(-INFINITY);
+        }
+        float binScale = BIN_COUNT / extent[axis];
+        for (uint32_t i = first; i < first + count; i++) {
+            uint32_t p = _primitives[i];
+            unsigned int b = std::min((unsigned int)((_centroids[p][axis] - centroidMin[axis]) * binScale), BIN_COUNT - 1);
+            binCounts[b]++;
+            binMin[b] = glm::min(binMin[b], _boundsMin[p]);
+            binMax[b] = glm::max(binMax[b], _boundsMax[p]);
+        }
+
+        // Sweep from the right to get the area and count right of each split
+        float rightArea[BIN_COUNT];
+        unsigned int rightCount[BIN_COUNT];
+        glm::vec3 sweepMin(INFINITY), sweepMax(-INFINITY);
+        unsigned int sweepCount = 0;
+        for (unsigned int b = BIN_COUNT - 1; b > 0; b--) {
+            sweepMin = glm::min(sweepMin, binMin[b]);
+            sweepMax = glm::max(sweepMax, binMax[b]);
+            sweepCount += binCounts[b];
+            rightArea[b] = sweepCount ? surfaceArea(sweepMin, sweepMax) : 0.0f;
+            rightCount[b] = sweepCount;
+        }
+
+        sweepMin = glm::vec3(INFINITY);
+        sweepMax = glm::vec3(-INFINITY);
+        sweepCount = 0;
+        for (unsigned int split = 1; split < BIN_COUNT; split++) {
+            sweepMin = glm::min(sweepMin, binMin[split - 1]);
+            sweepMax = glm::max(sweepMax, binMax[split - 1]);
+            sweepCount += binCounts[split - 1];
+            if (sweepCount == 0 || rightCount[split] == 0) continue;
+
+            float cost = 1.0f + (sweepCount * surfaceArea(sweepMin, sweepMax) + rightCount[split] * rightArea[split]) / nodeArea;
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    uint32_t middle;
+    if (bestAxis >= 0) {
+        if (bestCost >= count && count <= MAX_LEAF_SIZE) {
+            makeLeaf();
+            return;
+        }
+        float binScale = BIN_COUNT / extent[bestAxis];
+        float splitCentroid = centroidMin[bestAxis];
+        auto middleIt = std::partition(_primitives.begin() + first, _primitives.begin() + first + count, [&](uint32_t p) {
+            return std::min((unsigned int)((_centroids[p][bestAxis] - splitCentroid) * binScale), BIN_COUNT - 1) < bestSplit;
+        });
+        middle = middleIt - _primitives.begin();
+    } else {
+        // Every centroid is the same - split in half
+        if (count <= MAX_LEAF_SIZE) {
+            makeLeaf();
+            return;
+        }
+        middle = first + count / 2;
+    }
+
+    uint32_t left = _nodes.size();
+    _nodes[node].first = left;
+    _nodes[node].count = 0;
+    _nodes.push_back({ glm::vec3(0.0f), glm::vec3(0.0f), 0, 0, node });
+    _nodes.push_back({ glm::vec3(0.0f), glm::vec3(0.0f), 0, 0, node });
+    buildNode(left, first, middle - first);
+    buildNode(left + 1, middle, first + count - middle);
+}
+
+void SceneBVH::refit(const SceneStore &scene)
+{
+    for (uint32_t i : scene.getUpdated()) {
+        uint32_t node = i < _leafOf.size() ? _leafOf[i] : NONE;
+        if (node == NONE) continue;
+
+        _boundsMin[i] = scene.getWorldBoundsMin(i);
+        _boundsMax[i] = scene.getWorldBoundsMax(i);
+
+        // Leaf bounds from its objects
+        Node &leaf = _nodes[node];
+        leaf.boundsMin = _boundsMin[_primitives[leaf.first]];
+        leaf.boundsMax = _boundsMax[_primitives[leaf.first]];
+        for (uint32_t p = leaf.first + 1; p < leaf.first + leaf.count; p++) {
+            leaf.boundsMin = glm::min(leaf.boundsMin, _boundsMin[_primitives[p]]);
+            leaf.boundsMax = glm::max(leaf.boundsMax, _boundsMax[_primitives[p]]);
+        }
+
+        // Walk up until a node's bounds don't change
+        for (uint32_t parent = leaf.parent; parent != NONE; parent = _nodes[parent].parent) {
+            Node &n = _nodes[parent];
+            const Node &a = _nodes[n.first], &b = _nodes[n.first + 1];
+            glm::vec3 boundsMin = glm::min(a.boundsMin, b.boundsMin), boundsMax = glm::max(a.boundsMax, b.boundsMax);
+            if (boundsMin == n.boundsMin && boundsMax == n.boundsMax) break;
+            n.boundsMin = boundsMin;
+            n.boundsMax = boundsMax;
+        }
+    }
+}
+
+float SceneBVH::getCost() const
+{
+    if (_nodes.empty()) return 0.0f;
+
+    float cost = 0.0f;
+    for (const Node &node : _nodes) {
+        float area = surfaceArea(node.boundsMin, node.boundsMax);
+        cost += node.count == 0 ? area : area * node.count;
+    }
+    return cost / std::max(surfaceArea(_nodes[0].boundsMin, _nodes[0].boundsMax), 1e-12f);
+}
+
+void SceneBVH::queryFrustum(const Frustum &frustum, vector<uint32_t> &results) const
+{
+    results.clear();
+    if (_nodes.empty()) return;
+
+    vector<uint32_t> stack { 0 };
+    while (!stack.empty()) {
+        const Node &node = _nodes[stack.back()];
+        stack.pop_back();
+        if (!frustum.intersects(node.boundsMin, node.boundsMax)) continue;
+
+        if (node.count == 0) {
+            stack.push_back(node.first);
+            stack.push_back(node.first + 1);
+            continue;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; i++) {
+            uint32_t p = _primitives[i];
+            if (node.count == 1 || frustum.intersects(_boundsMin[p], _boundsMax[p])) results.push_back(p);
+        }
+    }
+}
+
+void SceneBVH::querySphere(const glm::vec3 &center, float radius, vector<uint32_t> &results) const
+{
+    results.clear();
+    if (_nodes.empty()) return;
+
+    float radiusSquared = radius * radius;
+
+    vector<uint32_t> stack { 0 };
+    while (!stack.empty()) {
+        const Node &node = _nodes[stack.back()];
+        stack.pop_back();
+        if (!sphereHitsBox(center, radiusSquared, node.boundsMin, node.boundsMax)) continue;
+
+        if (node.count == 0) {
+            stack.push_back(node.first);
+            stack.push_back(node.first + 1);
+            continue;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; i++) {
+            uint32_t p = _primitives[i];
+            if (node.count == 1 || sphereHitsBox(center, radiusSquared, _boundsMin[p], _boundsMax[p])) results.push_back(p);
+        }
+    }
+}
+
+void SceneBVH::queryRay(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, 
+                        vector<std::pair<float, uint32_t>> &results) const
+{
+    results.clear();
+    if (_nodes.empty()) return;
+
+    glm::vec3 inverseDirection = 1.0f / direction;
+    vector<uint32_t> stack { 0 };
+    while (!stack.empty()) {
+        const Node &node = _nodes[stack.back()];
+        stack.pop_back();
+        float entry;
+        if (!rayHitsBox(origin, inverseDirection, maxDistance, node.boundsMin, node.boundsMax, entry)) continue;
+
+        if (node.count == 0) {
+            stack.push_back(node.first);
+            stack.push_back(node.first + 1);
+            continue;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; i++) {
+            uint32_t p = _primitives[i];
+            if (node.count == 1 || rayHitsBox(origin, inverseDirection, maxDistance, _boundsMin[p], _boundsMax[p], entry))
+                results.push_back({ entry, p });
+        }
+    }
+
+    std::sort(results.begin(), results.end());
+}
@@ -0,0 +1,82 @@
+#ifndef __SCENEBVH__
+#define __SCENEBVH__
+
+#include "global.h"
+#include <cstdint>
+
+#include "sceneStore.h"
+
+/**
+ * @brief The six planes of a view frustum, pointing inwards.
+ */
+struct Frustum {
+    glm::vec4 planes[6];
+
+    // Extracts the planes from a projection * view matrix
+    static Frustum fromMatrix(const glm::mat4 &viewProjection);
+
+    // Conservative: may accept boxes just outside a corner of the frustum
+    bool intersects(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) const;
+};
+
+/**
+ * @brief Bounding volume hierarchy over the world bounds of every object in a SceneStore.
+ *
+ * Built top down with a binned surface area heuristic. Each frame, the leaves of objects
+ * which moved are refitted and the change propagated up the tree. The tree is rebuilt
+ * whenever objects are created or destroyed, when refitting has degraded its SAH cost too
+ * far, and periodically.
+ *
+ * Queries test each object's own bounds and return dense SceneStore indices, which are
+ * valid until the store next changes structure. They don't look at object flags.
+ */
+class SceneBVH
+{
+public:
+    // Rebuilds or refits to match the store. Call after SceneStore::update().
+    void update(const SceneStore &scene);
+    void rebuild(const SceneStore &scene);
+
+    void queryFrustum(const Frustum &frustum, vector<uint32_t> &results) const;
+    void querySphere(const glm::vec3 &center, float radius, vector<uint32_t> &results) const;
+    /**
+     * @brief Objects whose bounds the ray hits within `maxDistance`, nearest first.
+     * `direction` needn't be normalized - distances are in multiples of it.
+     */
+    void queryRay(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, 
+                  vector<std::pair<float, uint32_t>> &results) const;
+
+    unsigned int getNodeCount() const { return _nodes.size(); }
+    // SAH cost now, and when last built
+    float getCost() const;
+    float getBuiltCost() const { return _builtCost; }
+
+private:
+    struct Node {
+        glm::vec3 boundsMin, boundsMax;
+        // Internal nodes: first child, the second follows it. Leaves: first primitive.
+        uint32_t first;
+        // Primitive count, 0 for internal nodes
+        uint32_t count;
+        uint32_t parent;
+    };
+
+    vector<Node> _nodes;
+    // Dense indices, grouped by leaf
+    vector<uint32_t> _primitives;
+    // Leaf node of each dense index
+    vector<uint32_t> _leafOf;
+
+    uint32_t _structureVersion { ~0u };
+    unsigned int _refitsSinceBuild { 0 };
+    float _builtCost { 0.0f };
+
+    // Per object, by dense index. Bounds are kept up to date by refitting.
+    vector<glm::vec3> _boundsMin, _boundsMax;
+    vector<glm::vec3> _centroids;
+
+    void buildNode(uint32_t node, uint32_t first, uint32_t count);
+    void refit(const SceneStore &scene);
+};
+
+#endif /* __SCENEBVH__ */
@@ -0,0 +1,345 @@
+#include "sceneStore.h"
+
+#include <algorithm>
+
+#include "model.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SCENESTORE_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace {
+
+const uint32_t NO_PARENT = ~0u;
+
+//
+// Batch kernels. Each runs over a list of dense indices.
+//
+
+/**
+ * @brief local = translate * scale * rotateX * rotateY * rotateZ, the order GameObject
+ * has always used.
+ */
+void computeLocalMatrices(const uint32_t *list, size_t count, const glm::vec3 *positions, 
+                          const glm::vec3 *rotations, const glm::vec3 *scales, glm::mat4 *local)
+{
+    for (size_t n = 0; n < count; n++) {
+        uint32_t i = list[n];
+        glm::vec3 c = glm::cos(rotations[i]), s = glm::sin(rotations[i]);
+        glm::vec3 scale = scales[i];
+
+        glm::mat4 &m = local[i];
+        m[0] = glm::vec4(scale * glm::vec3(c.y * c.z, s.x * s.y * c.z + c.x * s.z, -c.x * s.y * c.z + s.x * s.z), 0.0f);
+        m[1] = glm::vec4(scale * glm::vec3(-c.y * s.z, -s.x * s.y * s.z + c.x * c.z, c.x * s.y * s.z + s.x * c.z), 0.0f);
+        m[2] = glm::vec4(scale * glm::vec3(s.y, -s.x * c.y, c.x * c.y), 0.0f);
+        m[3] = glm::vec4(positions[i], 1.0f);
+    }
+}
+
+/**
+ * @brief world = parent world * local. The list must have parents before children.
+ */
+void computeWorldMatrices(const uint32_t *list, const uint32_t *parents, size_t count, 
+                          const glm::mat4 *local, glm::mat4 *world)
+{
+    for (size_t n = 0; n < count; n++) {
+        uint32_t i = list[n];
+        if (parents[n] == NO_PARENT) {
+            world[i] = local[i];
+            continue;
+        }
+
+#ifdef SCENESTORE_SSE
+        const float *a = &world[parents[n]][0][0];
+        const float *b = &local[i][0][0];
+        float *out = &world[i][0][0];
+        __m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + 4), a2 = _mm_loadu_ps(a + 8), a3 = _mm_loadu_ps(a + 12);
+        for (int column = 0; column < 4; column++) {
+            const float *bc = b + column * 4;
+            __m128 r = _mm_mul_ps(a0, _mm_set1_ps(bc[0]));
+            r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(bc[1])));
+            r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(bc[2])));
+            r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(bc[3])));
+            _mm_storeu_ps(out + column * 4, r);
+        }
+#else
+        world[i] = world[parents[n]] * local[i];
+#endif
+    }
+}
+
+/**
+ * @brief transpose(inverse(mat3(world))), as the cofactor matrix over the determinant.
+ */
+void computeNormalMatrices(const uint32_t *list, size_t count, const glm::mat4 *world, glm::mat3 *normal)
+{
+    for (size_t n = 0; n < count; n++) {
+        uint32_t i = list[n];
+        glm::vec3 c0(world[i][0]), c1(world[i][1]), c2(world[i][2]);
+        glm::vec3 x = glm::cross(c1, c2), y = glm::cross(c2, c0), z = glm::cross(c0, c1);
+        float det = glm::dot(c0, x);
+        float inverseDet = det != 0.0f ? 1.0f / det : 0.0f;
+        normal[i] = glm::mat3(x * inverseDet, y * inverseDet, z * inverseDet);
+    }
+}
+
+/**
+ * @brief World space AABBs of the local bounds, transforming the centre and extent
+ * rather than all eight corners.
+ */
+void transformBounds(const uint32_t *list, size_t count, const glm::mat4 *world,
+                     const glm::vec3 *localMin, const glm::vec3 *localMax, glm::vec3 *worldMin, glm::vec3 *worldMax)
+{
+    for (size_t n = 0; n < count; n++) {
+        uint32_t i = list[n];
+        glm::vec3 center = 0.5f * (localMin[i] + localMax[i]);
+        glm::vec3 extent = 0.5f * (localMax[i] - localMin[i]);
+
+#ifdef SCENESTORE_SSE
+        const float *m = &world[i][0][0];
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        __m128 m0 = _mm_loadu_ps(m), m1 = _mm_loadu_ps(m + 4), m2 = _mm_loadu_ps(m + 8), m3 = _mm_loadu_ps(m + 12);
+
+        __m128 c = _mm_add_ps(m3, _mm_mul_ps(m0, _mm_set1_ps(center.x)));
+        c = _mm_add_ps(c, _mm_mul_ps(m1, _mm_set1_ps(center.y)));
+        c = _mm_add_ps(c, _mm_mul_ps(m2, _mm_set1_ps(center.z)));
+
+        __m128 e = _mm_mul_ps(_mm_andnot_ps(signMask, m0), _mm_set1_ps(extent.x));
+        e = _mm_add_ps(e, _mm_mul_ps(_mm_andnot_ps(signMask, m1), _mm_set1_ps(extent.y)));
+        e = _mm_add_ps(e, _mm_mul_ps(_mm_andnot_ps(signMask, m2), _mm_set1_ps(extent.z)));
+
+        float boundsMin[4], boundsMax[4];
+        _mm_storeu_ps(boundsMin, _mm_sub_ps(c, e));
+        _mm_storeu_ps(boundsMax, _mm_add_ps(c, e));
+        worldMin[i] = glm::vec3(boundsMin[0], boundsMin[1], boundsMin[2]);
+        worldMax[i] = glm::vec3(boundsMax[0], boundsMax[1], boundsMax[2]);
+#else
+        glm::mat3 absolute(glm::abs(glm::vec3(world[i][0])), glm::abs(glm::vec3(world[i][1])), glm::abs(glm::vec3(world[i][2])));
+        glm::vec3 worldCenter = glm::vec3(world[i] * glm::vec4(center, 1.0f));
+        glm::vec3 worldExtent = absolute * extent;
+        worldMin[i] = worldCenter - worldExtent;
+        worldMax[i] = worldCenter + worldExtent;
+#endif
+    }
+}
+
+}
+
+SceneStore& SceneStore::instance()
+{
+    static SceneStore store;
+    return store;
+}
+
+SceneHandle SceneStore::create(Model *model)
+{
+    SceneHandle handle;
+    if (!_freeSlots.empty()) {
+        handle.index = _freeSlots.back();
+        _freeSlots.pop_back();
+    } else {
+        handle.index = _denseOf.size();
+        _denseOf.push_back(0);
+        _generations.push_back(0);
+    }
+    handle.generation = _generations[handle.index];
+    _denseOf[handle.index] = _models.size();
+
+    glm::vec3 boundsMin(0.0f), boundsMax(0.0f);
+    if (model) model->getBounds(boundsMin, boundsMax);
+
+    _slotOf.push_back(handle.index);
+    _models.push_back(model);
+    _flags.push_back(CASTS_SHADOW | DEFERRED);
+    _dirty.push_back(LOCAL_DIRTY | WORLD_DIRTY);
+    _positions.push_back(glm::vec3(0.0f));
+    _rotations.push_back(glm::vec3(0.0f));
+    _scales.push_back(glm::vec3(1.0f));
+    _parents.push_back(SceneHandle());
+    _localMatrices.push_back(glm::mat4(1.0f));
+    _worldMatrices.push_back(glm::mat4(1.0f));
+    _normalMatrices.push_back(glm::mat3(1.0f));
+    _localBoundsMin.push_back(boundsMin);
+    _localBoundsMax.push_back(boundsMax);
+    _worldBoundsMin.push_back(boundsMin);
+    _worldBoundsMax.push_back(boundsMax);
+    _lods.push_back(LodState());
+
+    _orderDirty = true;
+    _structureVersion++;
+    return handle;
+}
+
+void SceneStore::destroy(SceneHandle handle)
+{
+    if (!isValid(handle)) return;
+
+    // Orphan any children
+    for (unsigned int i = 0; i < size(); i++) {
+        if (_parents[i] == handle) {
+            _parents[i] = SceneHandle();
+            _dirty[i] |= WORLD_DIRTY;
+        }
+    }
+
+    // Move the last object into the hole
+    uint32_t hole = _denseOf[handle.index];
+    uint32_t last = size() - 1;
+    if (hole != last) {
+        _slotOf[hole] = _slotOf[last];
+        _models[hole] = _models[last];
+        _flags[hole] = _flags[last];
+        _dirty[hole] = _dirty[last];
+        _positions[hole] = _positions[last];
+        _rotations[hole] = _rotations[last];
+        _scales[hole] = _scales[last];
+        _parents[hole] = _parents[last];
+        _localMatrices[hole] = _localMatrices[last];
+        _worldMatrices[hole] = _worldMatrices[last];
+        _normalMatrices[hole] = _normalMatrices[last];
+        _localBoundsMin[hole] = _localBoundsMin[last];
+        _localBoundsMax[hole] = _localBoundsMax[last];
+        _worldBoundsMin[hole] = _worldBoundsMin[last];
+        _worldBoundsMax[hole] = _worldBoundsMax[last];
+        _lods[hole] = _lods[last];
+        _denseOf[_slotOf[hole]] = hole;
+    }
+
+    _slotOf.pop_back();
+    _models.pop_back();
+    _flags.pop_back();
+    _dirty.pop_back();
+    _positions.pop_back();
+    _rotations.pop_back();
+    _scales.pop_back();
+    _parents.pop_back();
+    _localMatrices.pop_back();
+    _worldMatrices.pop_back();
+    _normalMatrices.pop_back();
+    _localBoundsMin.pop_back();
+    _localBoundsMax.pop_back();
+    _worldBoundsMin.pop_back();
+    _worldBoundsMax.pop_back();
+    _lods.pop_back();
+
+    _generations[handle.index]++;
+    _freeSlots.push_back(handle.index);
+    _orderDirty = true;
+    _structureVersion++;
+}
+
+bool SceneStore::isValid(SceneHandle handle) const
+{
+    return handle.index < _generations.size() && _generations[handle.index] == handle.generation;
+}
+
+void SceneStore::setPosition(SceneHandle handle, const glm::vec3 &position)
+{
+    unsigned int i = indexOf(handle);
+    _positions[i] = position;
+    _dirty[i] |= LOCAL_DIRTY;
+}
+
+void SceneStore::setRotation(SceneHandle handle, const glm::vec3 &rotation)
+{
+    unsigned int i = indexOf(handle);
+    _rotations[i] = rotation;
+    _dirty[i] |= LOCAL_DIRTY;
+}
+
+void SceneStore::setScale(SceneHandle handle, const glm::vec3 &scale)
+{
+    unsigned int i = indexOf(handle);
+    _scales[i] = scale;
+    _dirty[i] |= LOCAL_DIRTY;
+}
+
+void SceneStore::setLocalBounds(SceneHandle handle, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax)
+{
+    unsigned int i = indexOf(handle);
+    _localBoundsMin[i] = boundsMin;
+    _localBoundsMax[i] = boundsMax;
+    _dirty[i] |= WORLD_DIRTY;
+}
+
+void SceneStore::setFlag(SceneHandle handle, Flags flag, bool value)
+{
+    uint8_t &flags = _flags[indexOf(handle)];
+    flags = value ? (flags | flag) : (flags & ~flag);
+}
+
+bool SceneStore::setParent(SceneHandle handle, SceneHandle parent)
+{
+    if (!isValid(parent)) parent = SceneHandle();
+
+    // Walk up from the new parent to make sure it isn't a descendant
+    for (SceneHandle ancestor = parent; isValid(ancestor); ancestor = _parents[indexOf(ancestor)]) {
+        if (ancestor == handle) {
+            std::cout << "ERROR::SCENESTORE::PARENT_CYCLE" << std::endl;
+            return false;
+        }
+    }
+
+    unsigned int i = indexOf(handle);
+    _parents[i] = parent;
+    _dirty[i] |= WORLD_DIRTY;
+    _orderDirty = true;
+    return true;
+}
+
+uint32_t SceneStore::parentIndex(unsigned int i) const
+{
+    return isValid(_parents[i]) ? indexOf(_parents[i]) : NO_PARENT;
+}
+
+void SceneStore::rebuildOrder()
+{
+    vector<uint32_t> depths(size());
+    for (unsigned int i = 0; i < size(); i++) {
+        uint32_t depth = 0;
+        for (uint32_t p = parentIndex(i); p != NO_PARENT; p = parentIndex(p)) depth++;
+        depths[i] = depth;
+    }
+
+    _order.resize(size());
+    for (unsigned int i = 0; i < size(); i++) _order[i] = i;
+    std::stable_sort(_order.begin(), _order.end(), [&depths](uint32_t a, uint32_t b) {
+        return depths[a] < depths[b];
+    });
+    _orderDirty = false;
+}
+
+void SceneStore::update()
+{
+    if (_orderDirty) rebuildOrder();
+
+    // Local matrices for objects whose own transform changed
+    _updated.clear();
+    for (unsigned int i = 0; i < size(); i++) {
+        if (_dirty[i] & LOCAL_DIRTY) _updated.push_back(i);
+    }
+    computeLocalMatrices(_updated.data(), _updated.size(), _positions.data(), _rotations.data(), _scales.data(), 
+                         _localMatrices.data());
+
+    // Propagate down the hierarchy, collecting every object whose world transform changed
+    _updated.clear();
+    _updatedParents.clear();
+    for (uint32_t i : _order) {
+        uint32_t parent = parentIndex(i);
+        if (parent != NO_PARENT && (_dirty[parent] & WORLD_DIRTY)) _dirty[i] |= WORLD_DIRTY;
+        if (_dirty[i]) {
+            _dirty[i] |= WORLD_DIRTY;
+            _updated.push_back(i);
+            _updatedParents.push_back(parent);
+        }
+    }
+    if (_updated.empty()) return;
+
+    computeWorldMatrices(_updated.data(), _updatedParents.data(), _updated.size(), _localMatrices.data(), _worldMatrices.data());
+    computeNormalMatrices(_updated.data(), _updated.size(), _worldMatrices.data(), _normalMatrices.data());
+    transformBounds(_updated.data(), _updated.size(), _worldMatrices.data(), _localBoundsMin.data(), _localBoundsMax.data(),
+                    _worldBoundsMin.data(), _worldBoundsMax.data());
+
+    for (uint32_t i : _updated) _dirty[i] = 0;
+}
@@ -0,0 +1,129 @@
+#ifndef __SCENESTORE__
+#define __SCENESTORE__
+
+#include "global.h"
+#include <cstdint>
+
+#include "renderPass.h"
+
+class Model;
+
+/**
+ * @brief Stable reference to an object in a SceneStore. Handles to destroyed objects
+ * are detected through the generation, even once their slot is reused.
+ */
+struct SceneHandle {
+    uint32_t index { ~0u };
+    uint32_t generation { 0 };
+
+    bool operator==(const SceneHandle &other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const SceneHandle &other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Structure of arrays storage for every object in the scene.
+ *
+ * Transforms, matrices, bounds and flags live in contiguous arrays indexed by a dense
+ * index, which changes when objects are destroyed; handles stay valid. update() runs
+ * the transform and bounds kernels over the arrays once per frame, in hierarchy order,
+ * only for objects whose transform (or an ancestor's) changed.
+ */
+class SceneStore
+{
+public:
+    enum Flags : uint8_t {
+        // Drawn by the renderer
+        ACTIVE       = 1 << 0,
+        CASTS_SHADOW = 1 << 1,
+        DEFERRED     = 1 << 2,
+        // Rasterized into the occlusion buffer, and never occlusion culled itself
+        OCCLUDER     = 1 << 3,
+    };
+
+    static SceneStore& instance();
+
+    SceneHandle create(Model *model);
+    void destroy(SceneHandle handle);
+    bool isValid(SceneHandle handle) const;
+
+    void setPosition(SceneHandle handle, const glm::vec3 &position);
+    void setRotation(SceneHandle handle, const glm::vec3 &rotation);
+    void setScale(SceneHandle handle, const glm::vec3 &scale);
+    void setLocalBounds(SceneHandle handle, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax);
+    void setFlag(SceneHandle handle, Flags flag, bool value);
+    /**
+     * @brief Makes `parent` the parent of `handle`, or detaches it for an invalid handle.
+     * @return false if this would create a cycle.
+     */
+    bool setParent(SceneHandle handle, SceneHandle parent);
+
+    // Recomputes local and world matrices, normal matrices and world bounds
+    void update();
+
+    // Dense access, valid until the next create() or destroy()
+    unsigned int size() const { return _models.size(); }
+    unsigned int indexOf(SceneHandle handle) const { return _denseOf[handle.index]; }
+    SceneHandle handleOf(unsigned int i) const { return { _slotOf[i], _generations[_slotOf[i]] }; }
+
+    Model* getModel(unsigned int i) const { return _models[i]; }
+    uint8_t getFlags(unsigned int i) const { return _flags[i]; }
+    const glm::vec3& getPosition(unsigned int i) const { return _positions[i]; }
+    const glm::vec3& getRotation(unsigned int i) const { return _rotations[i]; }
+    const glm::vec3& getScale(unsigned int i) const { return _scales[i]; }
+    SceneHandle getParent(unsigned int i) const { return _parents[i]; }
+    const glm::mat4& getWorldMatrix(unsigned int i) const { return _worldMatrices[i]; }
+    const glm::mat3& getNormalMatrix(unsigned int i) const { return _normalMatrices[i]; }
+    const glm::vec3& getWorldBoundsMin(unsigned int i) const { return _worldBoundsMin[i]; }
+    const glm::vec3& getWorldBoundsMax(unsigned int i) const { return _worldBoundsMax[i]; }
+    // Current level of detail for each render pass
+    unsigned int* getLods(unsigned int i) { return _lods[i].level; }
+
+    // Incremented whenever objects are created or destroyed, i.e. dense indices change
+    uint32_t getStructureVersion() const { return _structureVersion; }
+    // Dense indices whose world transform or bounds changed in the last update()
+    const vector<uint32_t>& getUpdated() const { return _updated; }
+
+private:
+    enum Dirty : uint8_t {
+        LOCAL_DIRTY = 1 << 0,
+        WORLD_DIRTY = 1 << 1,
+    };
+
+    struct LodState {
+        unsigned int level[RENDER_PASS_COUNT] {};
+    };
+
+    // Sparse slots, indexed by handle
+    vector<uint32_t> _denseOf;
+    vector<uint32_t> _generations;
+    vector<uint32_t> _freeSlots;
+
+    // Dense arrays
+    vector<uint32_t> _slotOf;
+    vector<Model*> _models;
+    vector<uint8_t> _flags;
+    vector<uint8_t> _dirty;
+    vector<glm::vec3> _positions;
+    vector<glm::vec3> _rotations;
+    vector<glm::vec3> _scales;
+    vector<SceneHandle> _parents;
+    vector<glm::mat4> _localMatrices;
+    vector<glm::mat4> _worldMatrices;
+    vector<glm::mat3> _normalMatrices;
+    vector<glm::vec3> _localBoundsMin, _localBoundsMax;
+    vector<glm::vec3> _worldBoundsMin, _worldBoundsMax;
+    vector<LodState> _lods;
+
+    // Dense indices with every parent before its children
+    vector<uint32_t> _order;
+    bool _orderDirty { true };
+    uint32_t _structureVersion { 0 };
+    // Scratch lists of objects updated this frame, and their parents' dense indices
+    vector<uint32_t> _updated;
+    vector<uint32_t> _updatedParents;
+
+    uint32_t parentIndex(unsigned int i) const;
+    void rebuildOrder();
+};
+
+#endif /* __SCENESTORE__ */
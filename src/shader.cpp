@@ -1,87 +1,299 @@
 #include "shader.h"
 
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
+#include <thread>
 #include <glm/gtc/type_ptr.hpp>
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
-    loadShader(vertexPath, GL_VERTEX_SHADER);
-    loadShader(fragmentPath, GL_FRAGMENT_SHADER);
-    link();
+#include "embeddedShaders.h"
+#include "glExtensions.h"
+#include "uniformBlocks.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+#ifdef SHADER_CACHE_DIR
+const char *SHADER_CACHE_DIRECTORY = SHADER_CACHE_DIR;
+#else
+const char *SHADER_CACHE_DIRECTORY = "../cache/shaders/";
+#endif
+const uint32_t PROGRAM_BINARY_MAGIC = 0x4e424750; // "PGBN"
+
+// Precedes the driver's binary in a cache file
+struct ProgramBinaryHeader {
+    uint32_t magic;
+    uint32_t format;
+    uint32_t length;
+};
+
+Shader::CacheStats cacheStats;
+
+/**
+ * @brief Gets a shader's source by file name - from the override directory if one was
+ * configured and has the file, otherwise from the copy embedded at build time.
+ */
+bool readShaderSource(const char *name, string &code) {
+#ifdef SHADER_OVERRIDE_DIR
+    std::ifstream file(SHADER_OVERRIDE_DIR + string(name));
+    if (file) {
+        std::stringstream stream;
+        stream << file.rdbuf();
+        code = stream.str();
+        return true;
+    }
+#endif
+    const EmbeddedShader *shader = findEmbeddedShader(name);
+    if (!shader) return false;
+    code.assign(shader->source.data(), shader->source.size());
+    return true;
 }
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath) {
-    loadShader(vertexPath, GL_VERTEX_SHADER);
-    loadShader(geometryPath, GL_GEOMETRY_SHADER);
-    loadShader(fragmentPath, GL_FRAGMENT_SHADER);
-    link();
+// FNV-1a, continued from `hash`
+uint64_t hashBytes(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
 }
 
-void Shader::loadShader(const char* path, GLuint shaderType)
-{
-    // 1. retrieve the vertex/fragment source code from filePath
-    std::string code;
-    std::ifstream file;
+uint64_t hashString(uint64_t hash, const char *text) {
+    return text ? hashBytes(hash, text, strlen(text) + 1) : hash;
+}
 
-    // ensure ifstream objects can throw exceptions:
-    file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    try {
-        // Open file
-        file.open(path);
-        std::stringstream stream;
-        // Read file to stream
-        stream << file.rdbuf();		
-        file.close();
-        // Convert stream to string
-        code = stream.str();		
-    } catch(std::ifstream::failure e) {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-    }
-    const char* codeRaw = code.c_str();
-
-    // 2. compile shader
-    unsigned int shader;
-    int success;
-    char infoLog[512];
-    
-    shader = glCreateShader(shaderType);
-    glShaderSource(shader, 1, &codeRaw, NULL);
-    glCompileShader(shader);
+// A program whose build was submitted, but whose status hasn't been checked
+struct PendingProgram {
+    unsigned int ID { 0 };
+    vector<ShaderSource> sources;
+    vector<unsigned int> parts;
+    string cachePath;
+    bool cached { false };
+};
 
-    // print compile errors if any
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if(!success) {
-        glGetShaderInfoLog(shader, 512, NULL, infoLog);
-        std::cout << "ERROR: Shader compilation failed for " << path << std::endl;
-        std::cout << infoLog << std::endl;
-    };
+// Programs waiting for the open batch to finish
+bool batchOpen = false;
+vector<PendingProgram> pendingPrograms;
 
-    _shaderParts.push_back(shader);
+string cachePath(const vector<ShaderSource> &sources) {
+    // Binaries only load on the driver which wrote them
+    uint64_t hash = 14695981039346656037ull;
+    hash = hashString(hash, (const char*)glGetString(GL_VENDOR));
+    hash = hashString(hash, (const char*)glGetString(GL_RENDERER));
+    hash = hashString(hash, (const char*)glGetString(GL_VERSION));
+    for (const ShaderSource &source : sources) {
+        hash = hashBytes(hash, &source.type, sizeof(source.type));
+        hash = hashString(hash, source.code.c_str());
+    }
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+    return SHADER_CACHE_DIRECTORY + string(name) + ".bin";
 }
 
-void Shader::link() {
-    // Attach shaders
-    ID = glCreateProgram();
-    for (int i = 0; i < _shaderParts.size(); i++) {
-        glAttachShader(ID, _shaderParts[i]);
+/**
+ * @brief Compiles the sources and links them into the program, without waiting for either.
+ */
+void submitCompile(PendingProgram &program) {
+    for (const ShaderSource &source : program.sources) {
+        const char* codeRaw = source.code.c_str();
+        unsigned int shader = glCreateShader(source.type);
+        glShaderSource(shader, 1, &codeRaw, NULL);
+        glCompileShader(shader);
+        glAttachShader(program.ID, shader);
+        program.parts.push_back(shader);
     }
-    glLinkProgram(ID);
+    if (glExtensions.getProgramBinary) glProgramParameteri(program.ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program.ID);
+}
 
-    // Print linking errors if any
+/**
+ * @brief Loads a cached binary into the program, without checking the driver accepted it.
+ *
+ * @return false if there is no usable cache file.
+ */
+bool loadBinary(unsigned int ID, const string &path) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    ProgramBinaryHeader header;
+    vector<unsigned char> binary;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && header.magic == PROGRAM_BINARY_MAGIC;
+    if (ok) {
+        binary.resize(header.length);
+        ok = fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+    if (!ok) return false;
+
+    glProgramBinary(ID, header.format, binary.data(), binary.size());
+    return true;
+}
+
+void saveBinary(unsigned int ID, const string &path) {
+    int length = 0;
+    glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    ProgramBinaryHeader header = { PROGRAM_BINARY_MAGIC, 0, 0 };
+    vector<unsigned char> binary(length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(ID, length, &written, &format, binary.data());
+    header.format = format;
+    header.length = written;
+
+    std::error_code error;
+    fs::create_directories(fs::path(path).parent_path(), error);
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cout << "ERROR::SHADER::CANNOT_WRITE_CACHE " << path << std::endl;
+        return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+           && fwrite(binary.data(), 1, written, file) == (size_t)written;
+    fclose(file);
+
+    if (!ok) {
+        std::cout << "ERROR::SHADER::CANNOT_WRITE_CACHE " << path << std::endl;
+        remove(path.c_str());
+    }
+}
+
+/**
+ * @brief Checks a submitted program, falling back to the sources if the driver rejected
+ * its cached binary - after an update, for instance. Reports errors, caches new binaries
+ * and sets the uniform block bindings.
+ */
+void complete(PendingProgram &program) {
     int success;
+    glGetProgramiv(program.ID, GL_LINK_STATUS, &success);
+    if (!success && program.cached) {
+        program.cached = false;
+        submitCompile(program);
+        glGetProgramiv(program.ID, GL_LINK_STATUS, &success);
+    }
+
+    if (program.cached) {
+        cacheStats.hits++;
+    } else {
+        cacheStats.misses++;
+
+        string paths;
+        for (const ShaderSource &source : program.sources)
+            paths += (paths.empty() ? "" : ", ") + source.path;
+        std::cout << "Compiled shader program (" << paths << ")" << std::endl;
+    }
+
+    // print compile and linking errors if any
     char infoLog[512];
-    glGetProgramiv(ID, GL_LINK_STATUS, &success);
-    if(!success)
-    {
-        glGetProgramInfoLog(ID, 512, NULL, infoLog);
+    if (!success) {
+        for (unsigned int i = 0; i < program.parts.size(); i++) {
+            int compiled;
+            glGetShaderiv(program.parts[i], GL_COMPILE_STATUS, &compiled);
+            if (compiled) continue;
+            glGetShaderInfoLog(program.parts[i], 512, NULL, infoLog);
+            std::cout << "ERROR: Shader compilation failed for " << program.sources[i].path << std::endl;
+            std::cout << infoLog << std::endl;
+        }
+        glGetProgramInfoLog(program.ID, 512, NULL, infoLog);
         std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    } else if (!program.cached && glExtensions.getProgramBinary) {
+        saveBinary(program.ID, program.cachePath);
     }
 
     // Delete linked shaders, no longer needed
-    for (int i = 0; i < _shaderParts.size(); i++) {
-        glDeleteShader(_shaderParts[i]);
+    for (unsigned int shader : program.parts) {
+        glDetachShader(program.ID, shader);
+        glDeleteShader(shader);
+    }
+    program.parts.clear();
+
+    // GL 3.3 can't set block bindings in GLSL, and linking or loading a binary resets them
+    for (unsigned int i = 0; i < UNIFORM_BLOCK_COUNT; i++) {
+        unsigned int index = glGetUniformBlockIndex(program.ID, UNIFORM_BLOCK_NAMES[i]);
+        if (index != GL_INVALID_INDEX) glUniformBlockBinding(program.ID, index, i);
+    }
+    if (glExtensions.multiDrawIndirect) {
+        for (unsigned int i = 0; i < STORAGE_BLOCK_COUNT; i++) {
+            unsigned int index = glGetProgramResourceIndex(program.ID, GL_SHADER_STORAGE_BLOCK, STORAGE_BLOCK_NAMES[i]);
+            if (index != GL_INVALID_INDEX) glShaderStorageBlockBinding(program.ID, index, i);
+        }
+    }
+}
+
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines &defines) {
+    loadShader(vertexPath, GL_VERTEX_SHADER, defines);
+    loadShader(fragmentPath, GL_FRAGMENT_SHADER, defines);
+    build();
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const ShaderDefines &defines) {
+    loadShader(vertexPath, GL_VERTEX_SHADER, defines);
+    loadShader(geometryPath, GL_GEOMETRY_SHADER, defines);
+    loadShader(fragmentPath, GL_FRAGMENT_SHADER, defines);
+    build();
+}
+
+Shader::Shader(const char* computePath, const ShaderDefines &defines) {
+    loadShader(computePath, GL_COMPUTE_SHADER, defines);
+    build();
+}
+
+void Shader::loadShader(const char* path, GLuint shaderType, const ShaderDefines &defines)
+{
+    std::string code;
+    if (!readShaderSource(path, code)) {
+        std::cout << "ERROR::SHADER::SOURCE_NOT_FOUND " << path << std::endl;
+    }
+
+    // Defines must follow #version, and #line keeps error messages pointing at the file's lines
+    if (!defines.empty()) {
+        size_t versionEnd = code.compare(0, 8, "#version") == 0 ? code.find('\n') : string::npos;
+        string injected;
+        for (const auto &define : defines)
+            injected += "#define " + define.first + " " + define.second + "\n";
+        if (versionEnd == string::npos) {
+            code = injected + "#line 1\n" + code;
+        } else {
+            code.insert(versionEnd + 1, injected + "#line 2\n");
+        }
+    }
+
+    _sources.push_back({ shaderType, path, code });
+}
+
+/**
+ * @brief Loads the program from the binary cache, or compiles and links the sources, then
+ * completes it - or leaves that to the open batch.
+ */
+void Shader::build() {
+    auto start = std::chrono::steady_clock::now();
+
+    PendingProgram program;
+    program.sources = std::move(_sources);
+    program.cachePath = cachePath(program.sources);
+
+    ID = glCreateProgram();
+    program.ID = ID;
+    program.cached = glExtensions.getProgramBinary && loadBinary(ID, program.cachePath);
+    if (!program.cached) submitCompile(program);
+
+    cacheStats.submitSeconds += std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    if (batchOpen) {
+        pendingPrograms.push_back(std::move(program));
+    } else {
+        start = std::chrono::steady_clock::now();
+        complete(program);
+        cacheStats.waitSeconds += std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
     }
-    _shaderParts.clear();
 }
 
 void Shader::use() const
@@ -124,6 +336,16 @@ void Shader::setVec3(const std::string &name, const glm::vec3 &value) const
     glUniform3f(glGetUniformLocation(ID, name.c_str()), value.x, value.y, value.z); 
 } 
 
+void Shader::setVec4(const std::string &name, const glm::vec4 &value) const
+{ 
+    glUniform4f(glGetUniformLocation(ID, name.c_str()), value.x, value.y, value.z, value.w); 
+} 
+
+void Shader::setMat3(const std::string &name, const glm::mat3 &value) const
+{ 
+    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value)); 
+} 
+
 void Shader::setMat4(const std::string &name, const glm::mat4 &value) const
 { 
     glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value)); 
@@ -141,4 +363,56 @@ bool Shader::isValid() const {
     glValidateProgram(ID);
     glGetProgramiv(ID, GL_VALIDATE_STATUS, &valid);
     return valid == GL_TRUE;
-}
\ No newline at end of file
+}
+
+const Shader::CacheStats& Shader::getCacheStats() {
+    return cacheStats;
+}
+
+ShaderBatch::ShaderBatch()
+{
+    if (batchOpen) return;
+    batchOpen = _open = true;
+}
+
+ShaderBatch::~ShaderBatch()
+{
+    finish();
+}
+
+void ShaderBatch::finish()
+{
+    if (!_open) return;
+    _open = batchOpen = false;
+
+    auto start = std::chrono::steady_clock::now();
+    unsigned int count = pendingPrograms.size();
+    if (glExtensions.parallelShaderCompile) {
+        // Complete programs in the order the driver finishes them
+        vector<bool> done(count, false);
+        unsigned int remaining = count;
+        while (remaining > 0) {
+            bool progress = false;
+            for (unsigned int i = 0; i < count; i++) {
+                if (done[i]) continue;
+                int finished = 0;
+                glGetProgramiv(pendingPrograms[i].ID, GL_COMPLETION_STATUS_KHR, &finished);
+                if (!finished) continue;
+
+                complete(pendingPrograms[i]);
+                done[i] = progress = true;
+                remaining--;
+            }
+            if (!progress) std::this_thread::yield();
+        }
+    } else {
+        for (PendingProgram &program : pendingPrograms)
+            complete(program);
+    }
+    pendingPrograms.clear();
+
+    float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    cacheStats.waitSeconds += seconds;
+    std::cout << "Shader batch: " << count << " programs finished in " << seconds * 1000.0f << "ms"
+              << (glExtensions.parallelShaderCompile ? ", compiled in parallel" : "") << std::endl;
+}
@@ -3,21 +3,60 @@
 
 #include "global.h"
 
+#include <map>
+
+/**
+ * @brief Preprocessor definitions for a program, by name. Injected after `#version`.
+ */
+using ShaderDefines = std::map<string, string>;
+
+struct ShaderSource {
+    GLenum type;
+    string path;
+    string code;
+};
+
+/**
+ * @brief A linked program, built from GLSL sources.
+ *
+ * Sources are named by file name within src/shaders, and come from the copies embedded
+ * at build time - or from SHADER_OVERRIDE_DIR when the build sets one.
+ *
+ * Linked programs are cached in SHADER_CACHE_DIR as driver binaries, keyed by a hash of the sources
+ * and the driver, where ARB_get_program_binary is available, so edited shaders miss the
+ * cache and are rebuilt.
+ *
+ * Defines are part of the source, so each combination is a separate program - see
+ * ShaderVariants.
+ *
+ * Built programs are checked for errors straight away, unless a ShaderBatch is open.
+ */
 class Shader
 {
+public:
+    // Programs built since launch, and the time spent on them
+    struct CacheStats {
+        unsigned int hits { 0 };
+        unsigned int misses { 0 };
+        // Submitting builds, and waiting for the driver to finish them
+        float submitSeconds { 0.0f };
+        float waitSeconds { 0.0f };
+    };
+
 private:
-    vector<unsigned int> _shaderParts; 
-    void init();
-    void loadShader(const char* path, GLuint shaderType);
-    void link();
+    vector<ShaderSource> _sources;
+    void loadShader(const char* path, GLuint shaderType, const ShaderDefines &defines);
+    void build();
 
 public:
     // the program ID
     unsigned int ID;
   
     Shader() {}
-    Shader(const char* vertexPath, const char* fragmentPath);
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath);
+    Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines &defines = {});
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const ShaderDefines &defines = {});
+    // A compute program - needs glExtensions.computeShader
+    explicit Shader(const char* computePath, const ShaderDefines &defines = {});
     
     // use/activate the shader
     void use() const;
@@ -29,9 +68,36 @@ public:
     void setVec2(const string &name, float valX, float valY) const;
     void setVec3(const string &name, const glm::vec3 &value) const;
     void setVec3(const string &name, float valX, float valY, float valZ) const;
+    void setVec4(const string &name, const glm::vec4 &value) const;
+    void setMat3(const string &name, const glm::mat3 &value) const;
     void setMat4(const string &name, const glm::mat4 &value) const;
 
     bool isValid() const;
+
+    static const CacheStats& getCacheStats();
+};
+
+/**
+ * @brief While one is alive, Shaders only submit their compiles and links. Their status is
+ * checked in finish(), once everything has been submitted, so the driver can work on all
+ * of them together - on its own threads, where it has KHR_parallel_shader_compile.
+ *
+ * Programs built in a batch must not be used until it finishes. Batches don't nest; an
+ * inner one does nothing.
+ */
+class ShaderBatch
+{
+public:
+    ShaderBatch();
+    ~ShaderBatch();
+    ShaderBatch(const ShaderBatch&) = delete;
+    ShaderBatch& operator=(const ShaderBatch&) = delete;
+
+    // Waits for every program submitted since the batch opened, reporting errors and caching binaries
+    void finish();
+
+private:
+    bool _open { false };
 };
   
 #endif /* __SHADER__ */
@@ -0,0 +1,20 @@
+#include "shaderVariants.h"
+
+ShaderVariants::ShaderVariants(const char* vertexPath, const char* fragmentPath, const char* geometryPath)
+: _vertexPath(vertexPath), _fragmentPath(fragmentPath), _geometryPath(geometryPath ? geometryPath : "") {}
+
+Shader& ShaderVariants::get(const ShaderDefines &defines)
+{
+    // Defines are ordered, so equal sets give equal keys
+    string key;
+    for (const auto &define : defines)
+        key += define.first + "=" + define.second + ";";
+
+    auto found = _variants.find(key);
+    if (found != _variants.end()) return found->second;
+
+    Shader shader = _geometryPath.empty()
+        ? Shader(_vertexPath.c_str(), _fragmentPath.c_str(), defines)
+        : Shader(_vertexPath.c_str(), _fragmentPath.c_str(), _geometryPath.c_str(), defines);
+    return _variants.emplace(key, shader).first->second;
+}
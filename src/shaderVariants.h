@@ -0,0 +1,28 @@
+#ifndef __SHADERVARIANTS__
+#define __SHADERVARIANTS__
+
+#include "global.h"
+#include "shader.h"
+
+/**
+ * @brief The programs built from one set of sources under different defines, so feature
+ * switches compile away rather than branching per pixel.
+ *
+ * Variants are built the first time they are asked for and kept, so each combination in
+ * use costs one build - usually a hit in the program binary cache.
+ */
+class ShaderVariants
+{
+public:
+    ShaderVariants() {}
+    ShaderVariants(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr);
+
+    Shader& get(const ShaderDefines &defines = {});
+    unsigned int getVariantCount() const { return _variants.size(); }
+
+private:
+    string _vertexPath, _fragmentPath, _geometryPath;
+    std::map<string, Shader> _variants;
+};
+
+#endif /* __SHADERVARIANTS__ */
@@ -0,0 +1,84 @@
+#version 330 core
+#extension GL_ARB_compute_shader : require
+#extension GL_ARB_shader_storage_buffer_object : require
+
+// Sets each indirect command's instance count to 1 if its mesh can be seen from the view,
+// or 0 to skip it. Must agree with IndirectDraws::isVisible.
+
+layout (local_size_x = 64) in;
+
+struct Command {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+layout (std430) buffer Commands {
+    Command commands[];
+};
+
+// See DrawBlock
+struct Draw {
+    mat4 world;
+    vec4 normal[3];
+    vec4 offset;
+    vec4 scale;
+    vec4 layers;
+};
+layout (std430) readonly buffer Draws {
+    Draw draws[];
+};
+
+// See BoundsBlock
+struct Bounds {
+    vec4 boundsMin;
+    vec4 boundsMax;
+};
+layout (std430) readonly buffer MeshBounds {
+    Bounds bounds[];
+};
+
+uniform int drawCount;
+// A mesh is kept if its bounds touch any of these
+uniform mat4 viewProjections[6];
+uniform int viewCount;
+// Meshes further than maxDistance from origin are culled, unless it is 0
+uniform vec3 origin;
+uniform float maxDistance;
+
+bool insideFrustum(mat4 viewProjection, vec3 center, vec3 extent)
+{
+    // Clip planes from the rows of the matrix, tested against the box's projected radius
+    mat4 rows = transpose(viewProjection);
+    vec4 planes[6] = vec4[6](rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+                             rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2]);
+    for (int i = 0; i < 6; i++) {
+        float radius = dot(abs(planes[i].xyz), extent);
+        if (dot(planes[i].xyz, center) + planes[i].w < -radius) return false;
+    }
+    return true;
+}
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= uint(drawCount)) return;
+
+    // World space box around the mesh's bounds
+    mat4 world = draws[index].world;
+    vec3 localCenter = (bounds[index].boundsMin.xyz + bounds[index].boundsMax.xyz) * 0.5;
+    vec3 localExtent = (bounds[index].boundsMax.xyz - bounds[index].boundsMin.xyz) * 0.5;
+    vec3 center = vec3(world * vec4(localCenter, 1.0));
+    vec3 extent = abs(world[0].xyz) * localExtent.x + abs(world[1].xyz) * localExtent.y
+                + abs(world[2].xyz) * localExtent.z;
+
+    bool visible = viewCount == 0;
+    for (int i = 0; i < viewCount && !visible; i++)
+        visible = insideFrustum(viewProjections[i], center, extent);
+    if (visible && maxDistance > 0.0) {
+        vec3 nearest = clamp(origin, center - extent, center + extent);
+        visible = distance(nearest, origin) <= maxDistance;
+    }
+    commands[index].instanceCount = visible ? 1u : 0u;
+}
@@ -1,9 +1,43 @@
 #version 330 core
+// Defined for the multi-draw path, which reads each draw's data from the Draws block
+// #define MULTI_DRAW
+#ifdef MULTI_DRAW
+#extension GL_ARB_shader_draw_parameters : require
+#extension GL_ARB_shader_storage_buffer_object : require
+#endif
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 model;
+#ifdef MULTI_DRAW
+// See DrawBlock
+struct Draw {
+    mat4 world;
+    vec4 normal[3];
+    vec4 offset;
+    vec4 scale;
+    vec4 layers;
+};
+layout (std430) readonly buffer Draws {
+    Draw draws[];
+};
+// The batch's first draw in the block
+uniform int drawOffset;
+#define DRAW draws[drawOffset + gl_DrawIDARB]
+
+#define model DRAW.world
+#define positionOffset DRAW.offset.xyz
+#define positionScale DRAW.scale.xyz
+#else
+layout (std140) uniform Object {
+    mat4 model;
+    mat3 normalMatrix;
+};
+
+// Decodes quantized positions, see VertexFormat
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+#endif
 
 void main()
 {
-    gl_Position = model * vec4(aPos, 1.0);
+    gl_Position = model * vec4(positionOffset + aPos * positionScale, 1.0);
 } 
\ No newline at end of file
@@ -0,0 +1,11 @@
+#version 330 core
+// One triangle covering the screen, from gl_VertexID alone - see FullscreenPass
+
+out vec2 TexCoords;
+
+void main()
+{
+    // (0, 0), (2, 0) and (0, 2) in texture space, clipped to the screen
+    TexCoords = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(TexCoords * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -17,11 +17,29 @@ struct Material {
     sampler2D texturesSpecular[MAX_NR_TEXTURES];
     sampler2D textureNormal;
     float shininess;
-    bool hasNormalMap;
 }; 
 uniform Material material;
 
-uniform bool useNormalMaps;
+// Defined for meshes with a normal map, while normal mapping is enabled
+// #define NORMAL_MAP
+// Defined for materials packed into texture arrays, which are sampled instead
+// #define TEXTURE_ARRAYS
+
+#ifdef TEXTURE_ARRAYS
+uniform sampler2DArray diffuseArray;
+uniform sampler2DArray specularArray;
+uniform sampler2DArray normalArray;
+flat in vec3 TextureLayers;
+
+vec4 sampleDiffuse(vec2 uv) { return texture(diffuseArray, vec3(uv, TextureLayers.x)); }
+vec4 sampleSpecular(vec2 uv) { return texture(specularArray, vec3(uv, TextureLayers.y)); }
+vec4 sampleNormal(vec2 uv) { return texture(normalArray, vec3(uv, TextureLayers.z)); }
+#else
+// HACK: 0 index
+vec4 sampleDiffuse(vec2 uv) { return texture(material.texturesDiffuse[0], uv); }
+vec4 sampleSpecular(vec2 uv) { return texture(material.texturesSpecular[0], uv); }
+vec4 sampleNormal(vec2 uv) { return texture(material.textureNormal, uv); }
+#endif
 
 void main()
 {    
@@ -30,21 +48,20 @@ void main()
 
     // also store the per-fragment normals into the gbuffer
     vec3 Normal;
-    if (material.hasNormalMap && useNormalMaps) {
-        // obtain normal from normal map in range [0,1]
-        Normal = texture(material.textureNormal, fs_in.TexCoords).rgb;
-        // transform normal vector to range [-1,1]
-        Normal = Normal * 2.0 - 1.0; 
-        // transform from tangent space to world space
-        Normal = normalize(fs_in.TBN * Normal); 
-    } else {
-        Normal = normalize(fs_in.Normal);
-    }
+#ifdef NORMAL_MAP
+    // obtain normal from normal map in range [0,1], transformed to range [-1,1]
+    // z is reconstructed, since BC5 compressed normal maps only store x and y
+    Normal.xy = sampleNormal(fs_in.TexCoords).rg * 2.0 - 1.0;
+    Normal.z = sqrt(max(1.0 - dot(Normal.xy, Normal.xy), 0.0));
+    // transform from tangent space to world space
+    Normal = normalize(fs_in.TBN * Normal); 
+#else
+    Normal = normalize(fs_in.Normal);
+#endif
     gNormal = vec4(Normal, 1.0);
 
     // and the diffuse per-fragment color
-    // HACK: 0 index
-    gAlbedoSpec.rgb = texture(material.texturesDiffuse[0], fs_in.TexCoords).rgb;
+    gAlbedoSpec.rgb = sampleDiffuse(fs_in.TexCoords).rgb;
     // store specular intensity in gAlbedoSpec's alpha component
-    gAlbedoSpec.a = texture(material.texturesSpecular[0], fs_in.TexCoords).r;
+    gAlbedoSpec.a = sampleSpecular(fs_in.TexCoords).r;
 }  
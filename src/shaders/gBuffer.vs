@@ -1,8 +1,14 @@
 #version 330 core
+// Defined for the multi-draw path, which reads each draw's data from the Draws block
+// #define MULTI_DRAW
+#ifdef MULTI_DRAW
+#extension GL_ARB_shader_draw_parameters : require
+#extension GL_ARB_shader_storage_buffer_object : require
+#endif
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in vec3 aTangent;
+layout (location = 3) in vec4 aTangent; // w = bitangent sign
 
 out VS_OUT {
     vec3 FragPos;
@@ -11,23 +17,74 @@ out VS_OUT {
     mat3 TBN;
 } vs_out;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+};
+
+#ifdef MULTI_DRAW
+// See DrawBlock
+struct Draw {
+    mat4 world;
+    vec4 normal[3];
+    vec4 offset;
+    vec4 scale;
+    vec4 layers;
+};
+layout (std430) readonly buffer Draws {
+    Draw draws[];
+};
+// The batch's first draw in the block
+uniform int drawOffset;
+#define DRAW draws[drawOffset + gl_DrawIDARB]
+
+#define model DRAW.world
+#define normalMatrix mat3(DRAW.normal[0].xyz, DRAW.normal[1].xyz, DRAW.normal[2].xyz)
+#define positionOffset DRAW.offset.xyz
+#define positionScale DRAW.scale.xyz
+#else
+layout (std140) uniform Object {
+    mat4 model;
+    // transpose(inverse(mat3(model))), computed on the CPU when the object moves
+    mat3 normalMatrix;
+};
+
+// Decodes quantized positions, see VertexFormat
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+#endif
+
+#ifdef TEXTURE_ARRAYS
+#ifdef MULTI_DRAW
+#define aTextureLayers DRAW.layers.xyz
+#else
+// Array layer of the diffuse, specular and normal textures, set per material
+layout (location = 4) in vec3 aTextureLayers;
+#endif
+flat out vec3 TextureLayers;
+#endif
+
+// Must match depthPrepass.vs exactly
+invariant gl_Position;
 
 void main()
 {    
     // Calc TBN
-    vec3 bitangent = normalize(cross(aNormal, aTangent));
-    vec3 T = normalize(vec3(model * vec4(aTangent,   0.0)));
+    vec3 position = positionOffset + aPos * positionScale;
+    vec3 bitangent = normalize(cross(aNormal, aTangent.xyz)) * (aTangent.w < 0.0 ? -1.0 : 1.0);
+    vec3 T = normalize(vec3(model * vec4(aTangent.xyz, 0.0)));
     vec3 B = normalize(vec3(model * vec4(bitangent, 0.0)));
     vec3 N = normalize(vec3(model * vec4(aNormal,    0.0)));
     mat3 TBN = mat3(T, B, N);
 
-    vs_out.FragPos = vec3(model * vec4(aPos, 1.0));
-    vs_out.Normal = normalize(transpose(inverse(mat3(model))) * aNormal); 
+    vs_out.FragPos = vec3(model * vec4(position, 1.0));
+    vs_out.Normal = normalize(normalMatrix * aNormal); 
     vs_out.TexCoords = aTexCoords;
     vs_out.TBN = TBN;
+#ifdef TEXTURE_ARRAYS
+    TextureLayers = aTextureLayers;
+#endif
 
     gl_Position = projection * view * vec4(vs_out.FragPos, 1.0);
 }
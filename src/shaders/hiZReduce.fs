@@ -0,0 +1,29 @@
+#version 330 core
+out float FragDepth;
+
+// Only the level being reduced is visible through this
+uniform sampler2D source;
+
+void main()
+{
+    ivec2 sourceSize = textureSize(source, 0);
+    ivec2 destSize = max(sourceSize / 2, ivec2(1));
+    ivec2 dest = ivec2(gl_FragCoord.xy);
+    ivec2 base = dest * 2;
+
+    // Odd sizes leave a row or column over, which the last texel also covers
+    ivec2 count = ivec2(2);
+    if (dest.x == destSize.x - 1) count.x = sourceSize.x - base.x;
+    if (dest.y == destSize.y - 1) count.y = sourceSize.y - base.y;
+
+    float depth = 0.0;
+    for (int y = 0; y < 3; y++) {
+        if (y >= count.y) break;
+        for (int x = 0; x < 3; x++) {
+            if (x >= count.x) break;
+            ivec2 coord = min(base + ivec2(x, y), sourceSize - 1);
+            depth = max(depth, texelFetch(source, coord, 0).r);
+        }
+    }
+    FragDepth = depth;
+}
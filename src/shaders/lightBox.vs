@@ -2,13 +2,23 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in vec3 aTangent;
+layout (location = 3) in vec4 aTangent;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+};
+
+layout (std140) uniform Object {
+    mat4 model;
+    mat3 normalMatrix;
+};
+
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * model * vec4(positionOffset + aPos * positionScale, 1.0);
 } 
\ No newline at end of file
@@ -161,10 +161,10 @@ void main()
     vec3 viewDir = normalize(viewPos - fs_in.FragPos);
 
     if (material.hasNormalMap) {
-        // obtain normal from normal map in range [0,1]
-        norm = texture(material.textureNormal, fs_in.TexCoords).rgb;
-        // transform normal vector to range [-1,1]
-        norm = norm * 2.0 - 1.0; 
+        // obtain normal from normal map in range [0,1], transformed to range [-1,1]
+        // z is reconstructed, since BC5 compressed normal maps only store x and y
+        norm.xy = texture(material.textureNormal, fs_in.TexCoords).rg * 2.0 - 1.0;
+        norm.z = sqrt(max(1.0 - dot(norm.xy, norm.xy), 0.0));
         // transform from tangent space to world space
         norm = normalize(fs_in.TBN * norm); 
     }
@@ -2,7 +2,7 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in vec3 aTangent;
+layout (location = 3) in vec4 aTangent; // w = bitangent sign
 
 out VS_OUT {
     vec3 FragPos;
@@ -12,22 +12,35 @@ out VS_OUT {
     mat3 TBN;
 } vs_out;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+};
+
+layout (std140) uniform Object {
+    mat4 model;
+    // transpose(inverse(mat3(model))), computed on the CPU when the object moves
+    mat3 normalMatrix;
+};
+
+// Decodes quantized positions, see VertexFormat
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
 uniform mat4 lightSpaceMatrix;
 
 void main()
 {    
     // Calc TBN
-    vec3 bitangent = normalize(cross(aNormal, aTangent));
-    vec3 T = normalize(vec3(model * vec4(aTangent,   0.0)));
+    vec3 position = positionOffset + aPos * positionScale;
+    vec3 bitangent = normalize(cross(aNormal, aTangent.xyz)) * (aTangent.w < 0.0 ? -1.0 : 1.0);
+    vec3 T = normalize(vec3(model * vec4(aTangent.xyz, 0.0)));
     vec3 B = normalize(vec3(model * vec4(bitangent, 0.0)));
     vec3 N = normalize(vec3(model * vec4(aNormal,    0.0)));
     mat3 TBN = mat3(T, B, N);
 
-    vs_out.FragPos = vec3(model * vec4(aPos, 1.0));
-    vs_out.Normal = normalize(transpose(inverse(mat3(model))) * aNormal); 
+    vs_out.FragPos = vec3(model * vec4(position, 1.0));
+    vs_out.Normal = normalize(normalMatrix * aNormal); 
     vs_out.TexCoords = aTexCoords;
     vs_out.FragPosLightSpace = lightSpaceMatrix * vec4(vs_out.FragPos, 1.0);
     vs_out.TBN = TBN;
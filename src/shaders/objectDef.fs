@@ -1,11 +1,21 @@
 #version 330 core
 #define PI 3.1415926535
 #define MAX_NR_TEXTURES 16
-
-in VS_OUT {
-    vec3 FragPos;
-    vec2 TexCoords;
-} fs_in;
+#define MAX_NR_POINT_LIGHTS 16
+
+// The light setup this variant is built for
+#ifndef DIR_LIGHT_SHADOW
+#define DIR_LIGHT_SHADOW 0
+#endif
+#ifndef NR_POINT_LIGHTS
+#define NR_POINT_LIGHTS 0
+#endif
+// Bit i set if point light i casts shadows
+#ifndef POINT_LIGHT_SHADOWS
+#define POINT_LIGHT_SHADOWS 0
+#endif
+
+in vec2 TexCoords;
 
 out vec4 FragColor;
 
@@ -23,8 +33,9 @@ struct DirLight {
     vec3 diffuse;
     vec3 specular;
 
-    bool castsShadow;
     sampler2D shadowMap;
+    // 1 / the shadow map's size
+    vec2 shadowTexelSize;
     mat4 lightSpaceMatrix;
 };
 uniform DirLight dirLight;
@@ -40,11 +51,9 @@ struct PointLight {
     vec3 diffuse;
     vec3 specular;
 
-    bool castsShadow;
     samplerCube shadowMap;
 };  
-uniform PointLight pointLights[16];
-uniform int numberPointLights;
+uniform PointLight pointLights[MAX_NR_POINT_LIGHTS];
 
 uniform vec3 viewPos;
 
@@ -57,7 +66,8 @@ uniform sampler2D ssaoTexture;
 
 uniform vec3 skyboxColor;
 
-float ShadowCalculationDir(in vec4 fragPosLightSpace, in vec3 normal, in vec3 lightDir, in sampler2D shadowMap) {
+float ShadowCalculationDir(in vec4 fragPosLightSpace, in vec3 normal, in vec3 lightDir, in sampler2D shadowMap,
+                           in vec2 texelSize) {
     // perform perspective divide
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
      // transform to [0,1] range
@@ -76,7 +86,6 @@ float ShadowCalculationDir(in vec4 fragPosLightSpace, in vec3 normal, in vec3 li
     // float shadow = currentDepth - bias > closestDepth  ? 1.0 : 0.0;
 
     float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
     for(int x = -1; x <= 1; ++x)
     {
         for(int y = -1; y <= 1; ++y)
@@ -128,16 +137,17 @@ vec3 CalcDirLight(in FragData data, in DirLight light, in vec3 viewDir)
 
     // Shadow
     float shadow = 0.0;
-    if (light.castsShadow) {
-        vec4 fragPosLightSpace = light.lightSpaceMatrix * vec4(data.FragPos, 1.0); 
-        shadow = ShadowCalculationDir(fragPosLightSpace, data.Normal, lightDir, light.shadowMap);  
-    }
+#if DIR_LIGHT_SHADOW
+    vec4 fragPosLightSpace = light.lightSpaceMatrix * vec4(data.FragPos, 1.0); 
+    shadow = ShadowCalculationDir(fragPosLightSpace, data.Normal, lightDir, light.shadowMap, light.shadowTexelSize);  
+#endif
 
-    float ssao = texture(ssaoTexture, fs_in.TexCoords).r;
+    float ssao = texture(ssaoTexture, TexCoords).r;
     return ambient * ssao + (1.0 - shadow) * (diffuse + specular);
 }
 
-vec3 CalcPointLight(in FragData data, in PointLight light, vec3 viewDir)
+// `castsShadow` is constant once the light loop is unrolled, so the test folds away
+vec3 CalcPointLight(in FragData data, in PointLight light, vec3 viewDir, const bool castsShadow)
 {
     vec3 lightDir   = normalize(light.position - data.FragPos);
     vec3 halfwayDir = normalize(lightDir + viewDir);
@@ -158,23 +168,23 @@ vec3 CalcPointLight(in FragData data, in PointLight light, vec3 viewDir)
     specular *= attenuation;
 
     float shadow = 0.0;
-    if (light.castsShadow) {
+    if (castsShadow) {
         shadow = ShadowCalculationPoint(data.FragPos, light);
     }
 
-    float ssao = texture(ssaoTexture, fs_in.TexCoords).r;
+    float ssao = texture(ssaoTexture, TexCoords).r;
     return (ambient * ssao + (1.0 - shadow) * (diffuse + specular));
 } 
 
 void main()
 {
     // Load data from gBuffer
-    vec3 FragPos = texture(gPosition, fs_in.TexCoords).rgb;
-    vec4 fullNormal = texture(gNormal, fs_in.TexCoords);
+    vec3 FragPos = texture(gPosition, TexCoords).rgb;
+    vec4 fullNormal = texture(gNormal, TexCoords);
     vec3 Normal = fullNormal.rgb; 
     float isSkybox = fullNormal.a;
-    vec3 Albedo = texture(gAlbedoSpec, fs_in.TexCoords).rgb;
-    float Specular = texture(gAlbedoSpec, fs_in.TexCoords).a;
+    vec3 Albedo = texture(gAlbedoSpec, TexCoords).rgb;
+    float Specular = texture(gAlbedoSpec, TexCoords).a;
     FragData data = FragData(FragPos, Albedo, Normal, Specular);
 
     // Skybox
@@ -189,8 +199,8 @@ void main()
     // phase 1: Directional lighting
     vec3 result = CalcDirLight(data, dirLight, viewDir);
     // phase 2: Point lights
-    for(int i = 0; i < numberPointLights; i++)
-        result += CalcPointLight(data, pointLights[i], viewDir);    
+    for(int i = 0; i < NR_POINT_LIGHTS; i++)
+        result += CalcPointLight(data, pointLights[i], viewDir, (POINT_LIGHT_SHADOWS & (1 << i)) != 0);    
 
     FragColor = vec4(result, 1.0);
 }
\ No newline at end of file
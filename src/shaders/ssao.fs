@@ -1,5 +1,8 @@
 #version 330 core
+// Set to SSAORenderer's sample count
+#ifndef KERNEL_SIZE
 #define KERNEL_SIZE 64
+#endif
 #define RADIUS 0.2
 #define BIAS 0.025
 
@@ -14,15 +17,18 @@ uniform sampler2D texNoise;
 uniform vec3 samples[KERNEL_SIZE];
 uniform mat4 view;
 uniform mat4 projection;
-uniform vec2 screenRes;
-
+// Per frame constants, computed on the CPU
+// transpose(inverse(mat3(view)))
+uniform mat3 normalView;
+// The row of view giving view space z, for the depth of each sample
+uniform vec4 viewDepth;
 // tile noise texture over screen, based on screen dimensions divided by noise size
-vec2 noiseScale = screenRes / 4.0;
+uniform vec2 noiseScale;
 
 void main()
 {
     vec3 fragPos   = (view * vec4(texture(gPosition, TexCoords).xyz, 1.0)).xyz;
-    vec3 normal    = normalize(transpose(inverse(mat3(view))) * texture(gNormal, TexCoords).rgb);
+    vec3 normal    = normalize(normalView * texture(gNormal, TexCoords).rgb);
     vec3 randomVec = texture(texNoise, TexCoords * noiseScale).xyz;  
 
     vec3 tangent   = normalize(randomVec - normal * dot(randomVec, normal));
@@ -41,7 +47,7 @@ void main()
         offset.xyz /= offset.w;               // perspective divide
         offset.xyz  = offset.xyz * 0.5 + 0.5; // transform to range 0.0 - 1.0   
 
-        float sampleDepth = (view * vec4(texture(gPosition, offset.xy).xyz, 1.0)).z; 
+        float sampleDepth = dot(viewDepth, vec4(texture(gPosition, offset.xy).xyz, 1.0));
         float rangeCheck = smoothstep(0.0, 1.0, RADIUS / abs(fragPos.z - sampleDepth));
         occlusion += (sampleDepth >= samplePos.z + BIAS ? 1.0 : 0.0) * rangeCheck;
     }  
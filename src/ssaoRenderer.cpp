@@ -1,4 +1,5 @@
 #include "ssaoRenderer.h"
+#include <algorithm>
 #include <random>
 
 float __lerp(float a, float b, float f) {
@@ -9,23 +10,10 @@ void SSAORenderer::init(glm::ivec2 screenResolution) {
     if (_init) return;
     
     _screenRes = screenResolution;
+    generateKernel();
     
     std::uniform_real_distribution<float> randomFloats(0.0, 1.0); // random floats between [0.0, 1.0]
     std::default_random_engine generator;
-    for (unsigned int i = 0; i < NUM_SAMPLES; ++i) {
-        glm::vec3 sample(
-            randomFloats(generator) * 2.0 - 1.0, 
-            randomFloats(generator) * 2.0 - 1.0, 
-            randomFloats(generator)
-        );
-        sample  = glm::normalize(sample);
-        sample *= randomFloats(generator);
-        
-        float scale = (float)i / (float)NUM_SAMPLES; 
-        scale = __lerp(0.1f, 1.0f, scale * scale);
-        sample *= scale;
-        _kernel.push_back(sample);  
-    }
 
     // Generate noise
     std::vector<glm::vec3> ssaoNoise;
@@ -72,41 +60,88 @@ void SSAORenderer::init(glm::ivec2 screenResolution) {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     // Shader
-    _renderShader = Shader("../src/shaders/simpleQuad.vs", "../src/shaders/ssao.fs");
-    _blurShader = Shader("../src/shaders/simpleQuad.vs", "../src/shaders/ssaoBlur.fs");
+    _renderPass.init("ssao", "ssao.fs", { "gPosition", "gNormal", "texNoise" });
+    _renderPass.getShader({ { "KERNEL_SIZE", std::to_string(_sampleCount) } });
+    _blurPass.init("ssao blur", "ssaoBlur.fs", { "ssaoInput" });
+    _blurPass.getShader();
 
     _init = true;
 }
 
+void SSAORenderer::release() {
+    if (!_init) return;
+
+    glDeleteFramebuffers(1, &_FBO);
+    glDeleteFramebuffers(1, &_blurFBO);
+    unsigned int textures[] = { _colorBuffer, _blurBuffer, _noiseTexture };
+    glDeleteTextures(3, textures);
+    _renderPass.release();
+    _blurPass.release();
+    _kernelPrograms.clear();
+    _init = false;
+}
+
+/**
+ * @brief Hemisphere samples, denser towards the centre.
+ */
+void SSAORenderer::generateKernel() {
+    std::uniform_real_distribution<float> randomFloats(0.0, 1.0); // random floats between [0.0, 1.0]
+    std::default_random_engine generator;
+    _kernel.clear();
+    _kernelPrograms.clear();
+    for (unsigned int i = 0; i < _sampleCount; ++i) {
+        glm::vec3 sample(
+            randomFloats(generator) * 2.0 - 1.0, 
+            randomFloats(generator) * 2.0 - 1.0, 
+            randomFloats(generator)
+        );
+        sample  = glm::normalize(sample);
+        sample *= randomFloats(generator);
+        
+        float scale = (float)i / (float)_sampleCount; 
+        scale = __lerp(0.1f, 1.0f, scale * scale);
+        sample *= scale;
+        _kernel.push_back(sample);  
+    }
+}
+
+/**
+ * @brief Changes the samples per pixel. Each count is a separate shader variant, built on
+ * first use.
+ */
+void SSAORenderer::setSampleCount(unsigned int count) {
+    count = std::max(count, 1u);
+    if (count == _sampleCount) return;
+
+    _sampleCount = count;
+    generateKernel();
+}
+
 void SSAORenderer::draw(unsigned int gPosition, unsigned int gNormal, glm::mat4 projectionMatrix, glm::mat4 viewMatrix) {
-    glBindFramebuffer(GL_FRAMEBUFFER, _FBO);
+    Shader &renderShader = _renderPass.begin(_FBO, { gPosition, gNormal, _noiseTexture },
+                                             { { "KERNEL_SIZE", std::to_string(_sampleCount) } });
     glClear(GL_COLOR_BUFFER_BIT);    
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, gPosition);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, gNormal);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, _noiseTexture);
-
-    _renderShader.use();
     
-    for (int i = 0; i < NUM_SAMPLES; ++i) {
-        _renderShader.setVec3("samples[" + std::to_string(i) + "]", _kernel[i]);
+    // The kernel only changes with the sample count, so each variant gets it once
+    if (std::find(_kernelPrograms.begin(), _kernelPrograms.end(), renderShader.ID) == _kernelPrograms.end()) {
+        for (unsigned int i = 0; i < _sampleCount; ++i) {
+            renderShader.setVec3("samples[" + std::to_string(i) + "]", _kernel[i]);
+        }
+        _kernelPrograms.push_back(renderShader.ID);
     }
-    _renderShader.setMat4("projection", projectionMatrix);
-    _renderShader.setMat4("view", viewMatrix);
-    _renderShader.setVec2("screenRes", _screenRes);
+    renderShader.setMat4("projection", projectionMatrix);
+    renderShader.setMat4("view", viewMatrix);
+    // Rather than per pixel, or per sample
+    renderShader.setMat3("normalView", glm::transpose(glm::inverse(glm::mat3(viewMatrix))));
+    renderShader.setVec4("viewDepth", glm::vec4(viewMatrix[0][2], viewMatrix[1][2], viewMatrix[2][2], viewMatrix[3][2]));
+    renderShader.setVec2("noiseScale", glm::vec2(_screenRes) / 4.0f);
     
-    _quad.draw();
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    _renderPass.draw();
+    _renderPass.end();
     
     // Blur
-    glBindFramebuffer(GL_FRAMEBUFFER, _blurFBO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, _colorBuffer);
-    _blurShader.use();
-    _blurShader.setInt("ssaoInput", 0);
-
-    _quad.draw();
+    _blurPass.begin(_blurFBO, { _colorBuffer });
+    _blurPass.draw();
+    _blurPass.end();
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
\ No newline at end of file
@@ -2,27 +2,33 @@
 #define __SSAORENDERER__
 
 #include "global.h"
-#include "shader.h"
-#include "screenQuad.h"
+#include "fullscreenPass.h"
 
 class SSAORenderer {
-    const unsigned int NUM_SAMPLES = 64;
-
     bool _init { false };
+    // Samples per pixel, compiled into the shader
+    unsigned int _sampleCount { 64 };
     glm::ivec2 _screenRes;
     unsigned int _FBO, _colorBuffer, _noiseTexture;
     unsigned int _blurFBO, _blurBuffer;
     vector<glm::vec3> _kernel;
-    Shader _renderShader;
-    Shader _blurShader;
-    ScreenQuad _quad; 
+    // Programs the current kernel has been uploaded to
+    vector<unsigned int> _kernelPrograms;
+    FullscreenPass _renderPass;
+    FullscreenPass _blurPass;
+
+    void generateKernel();
 
 public:
     SSAORenderer() {};
     void init(glm::ivec2 screenResolution);
+    // Deletes the framebuffers, textures and passes
+    void release();
     void draw(unsigned int gPosition, unsigned int gNormal, glm::mat4 projectionMatrix, glm::mat4 viewMatrix);
 
     unsigned int getTexture() const { return _blurBuffer; }
+    void setSampleCount(unsigned int count);
+    unsigned int getSampleCount() const { return _sampleCount; }
 
 };
 
@@ -0,0 +1,166 @@
+#include "jobs.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+/**
+ * @file jobsTest.cpp
+ * @brief Checks the job system's scheduling: nesting, dependencies, waiting threads
+ * helping out, and stealing. Returns non-zero if any check fails.
+ */
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char *what)
+{
+    if (condition) return;
+    std::cout << "FAILED: " << what << std::endl;
+    failures++;
+}
+
+// Spins until `condition` holds, giving up after a few seconds so a broken pool fails rather than hangs
+template <typename Condition>
+bool waitFor(Condition condition)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+void testParallelForCoversRange()
+{
+    JobSystem system(3);
+    const unsigned int count = 1000;
+    std::vector<std::atomic<int>> visits(count);
+    system.parallelFor(count, 7, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++)
+            visits[i]++;
+    });
+
+    bool once = true;
+    for (const std::atomic<int> &visit : visits)
+        once = once && visit == 1;
+    check(once, "parallelFor visits every item exactly once");
+}
+
+void testNestedParallelFor()
+{
+    // Inner loops wait from inside jobs, which must run other jobs rather than block the pool
+    JobSystem system(2);
+    const unsigned int outer = 16, inner = 256;
+    std::atomic<unsigned int> total { 0 };
+    system.parallelFor(outer, 1, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            system.parallelFor(inner, 8, [&](unsigned int innerBegin, unsigned int innerEnd) {
+                total += innerEnd - innerBegin;
+            });
+        }
+    });
+    check(total == outer * inner, "nested parallelFor runs every inner item");
+}
+
+void testDependency()
+{
+    JobSystem system(2);
+    JobCounter first, second;
+    std::atomic<bool> firstDone { false };
+    std::atomic<bool> ranAfter { false };
+
+    system.run([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        firstDone = true;
+    }, &first);
+    system.run([&] { ranAfter = firstDone.load(); }, &second, &first);
+
+    check(!second.done(), "a dependent job counts against its counter while held back");
+    system.wait(second);
+    check(first.done(), "the dependency finished before the dependent job's counter");
+    check(ranAfter, "a dependent job runs only after its dependency reaches zero");
+
+    // Already at zero - queued straight away
+    JobCounter third;
+    std::atomic<bool> ran { false };
+    system.run([&] { ran = true; }, &third, &first);
+    system.wait(third);
+    check(ran, "a job depending on a finished counter runs");
+}
+
+void testWaitHelps()
+{
+    // The only worker is kept busy, so the waiting thread has to run the jobs itself
+    JobSystem system(1);
+    std::atomic<bool> release { false }, blocking { false };
+    JobCounter blocker;
+    system.run([&] {
+        blocking = true;
+        while (!release) std::this_thread::yield();
+    }, &blocker);
+    check(waitFor([&] { return blocking.load(); }), "the worker picks up the blocking job");
+
+    const std::thread::id mainThread = std::this_thread::get_id();
+    std::atomic<int> onMain { 0 };
+    const int jobCount = 32;
+    JobCounter counter;
+    for (int i = 0; i < jobCount; i++) {
+        system.run([&] {
+            if (std::this_thread::get_id() == mainThread) onMain++;
+        }, &counter);
+    }
+    system.wait(counter);
+    check(onMain == jobCount, "wait() runs queued jobs on the waiting thread");
+
+    release = true;
+    system.wait(blocker);
+}
+
+void testStealing()
+{
+    // A job queues children on its own worker's queue and spins without running them, so
+    // they only finish if another thread takes them from that queue
+    JobSystem system(2);
+    const int childCount = 8;
+    std::atomic<int> finished { 0 }, stolen { 0 };
+    std::atomic<bool> allFinished { false };
+    JobCounter parent, children;
+
+    system.run([&] {
+        const std::thread::id owner = std::this_thread::get_id();
+        for (int i = 0; i < childCount; i++) {
+            system.run([&, owner] {
+                if (std::this_thread::get_id() != owner) stolen++;
+                finished++;
+            }, &children);
+        }
+        allFinished = waitFor([&] { return finished.load() == childCount; });
+    }, &parent);
+
+    // Not wait(), which would run the job on this thread or take the children itself
+    check(waitFor([&] { return parent.done(); }), "the parent job finishes");
+    // Returns at once, but waits for the worker to release the counter
+    system.wait(parent);
+    system.wait(children);
+    check(allFinished, "children queued by a busy worker are stolen and run");
+    check(stolen == childCount, "stolen children ran on other threads");
+}
+
+}
+
+int main()
+{
+    testParallelForCoversRange();
+    testNestedParallelFor();
+    testDependency();
+    testWaitHelps();
+    testStealing();
+
+    if (failures == 0) std::cout << "All job system tests passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+#include "occlusionCuller.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+/**
+ * @file occlusionCullerBenchmark.cpp
+ * @brief Times rasterizing occluders into the WIDTH x HEIGHT buffer and testing boxes
+ * against it, for a scene of scattered walls.
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// A grid of `cells` x `cells` quads, 4 x 4 units, facing +z
+OccluderMesh grid(int cells)
+{
+    OccluderMesh mesh;
+    for (int y = 0; y <= cells; y++) {
+        for (int x = 0; x <= cells; x++)
+            mesh.positions.push_back(glm::vec3(-2.0f + 4.0f * x / cells, -2.0f + 4.0f * y / cells, 0.0f));
+    }
+    for (int y = 0; y < cells; y++) {
+        for (int x = 0; x < cells; x++) {
+            unsigned int i = y * (cells + 1) + x;
+            mesh.indices.insert(mesh.indices.end(), { i, i + 1, i + cells + 2, i, i + cells + 2, i + cells + 1 });
+        }
+    }
+    return mesh;
+}
+
+}
+
+int main()
+{
+    const int occluderCount = 32, boxCount = 10000, runs = 20;
+
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f),
+                                            (float)OcclusionCuller::WIDTH / OcclusionCuller::HEIGHT, 0.1f, 200.0f);
+    glm::mat4 viewProjection = projection * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    // Walls and boxes scattered in front of the camera
+    std::default_random_engine generator;
+    std::uniform_real_distribution<float> across(-20.0f, 20.0f), depth(-80.0f, -5.0f);
+    OccluderMesh mesh = grid(8);
+    std::vector<glm::mat4> occluders;
+    for (int i = 0; i < occluderCount; i++)
+        occluders.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(across(generator), across(generator) * 0.5f, depth(generator))));
+    std::vector<glm::vec3> boxes;
+    for (int i = 0; i < boxCount; i++)
+        boxes.push_back(glm::vec3(across(generator), across(generator) * 0.5f, depth(generator)));
+
+    OcclusionCuller culler;
+    double rasterizeBest = 0.0, testBest = 0.0;
+    unsigned int visible = 0;
+    for (int run = 0; run < runs; run++) {
+        Clock::time_point start = Clock::now();
+        culler.begin(viewProjection);
+        for (const glm::mat4 &world : occluders)
+            culler.addOccluder(mesh, world);
+        culler.rasterize();
+        double rasterize = millisecondsSince(start);
+
+        start = Clock::now();
+        visible = 0;
+        for (const glm::vec3 &box : boxes)
+            visible += culler.isVisible(box - glm::vec3(0.5f), box + glm::vec3(0.5f));
+        double test = millisecondsSince(start);
+
+        if (run == 0 || rasterize < rasterizeBest) rasterizeBest = rasterize;
+        if (run == 0 || test < testBest) testBest = test;
+    }
+
+    std::cout << OcclusionCuller::WIDTH << "x" << OcclusionCuller::HEIGHT << " buffer, "
+              << culler.getStats().triangles << " front facing triangles from " << occluderCount << " occluders" << std::endl;
+    std::cout << "Rasterize: " << rasterizeBest << "ms" << std::endl;
+    std::cout << "Test: " << boxCount << " boxes in " << testBest << "ms, " << testBest * 1.0e6 / boxCount
+              << "ns per box, " << visible << " visible" << std::endl;
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "occlusionCuller.h"
+
+#include <iostream>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+/**
+ * @file occlusionCullerTest.cpp
+ * @brief Checks the software occlusion culler against a single wall: boxes in front of,
+ * behind, straddling and beside it, and a wall facing away. Returns non-zero if any check
+ * fails.
+ */
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char *what)
+{
+    if (condition) return;
+    std::cout << "FAILED: " << what << std::endl;
+    failures++;
+}
+
+// A camera at the origin looking down -z, with the buffer's aspect ratio
+glm::mat4 viewProjection()
+{
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f),
+                                            (float)OcclusionCuller::WIDTH / OcclusionCuller::HEIGHT, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    return projection * view;
+}
+
+// A 10 x 10 square at z = -10, facing the camera unless `backFacing`
+OccluderMesh wall(bool backFacing)
+{
+    OccluderMesh mesh;
+    mesh.positions = { { -5.0f, -5.0f, -10.0f }, { 5.0f, -5.0f, -10.0f }, { 5.0f, 5.0f, -10.0f }, { -5.0f, 5.0f, -10.0f } };
+    if (backFacing)
+        mesh.indices = { 0, 2, 1, 0, 3, 2 };
+    else
+        mesh.indices = { 0, 1, 2, 0, 2, 3 };
+    return mesh;
+}
+
+void render(OcclusionCuller &culler, bool backFacing)
+{
+    culler.begin(viewProjection());
+    culler.addOccluder(wall(backFacing), glm::mat4(1.0f));
+    culler.rasterize();
+}
+
+void testFrontFacingWall()
+{
+    OcclusionCuller culler;
+    render(culler, false);
+    check(culler.getStats().triangles == 2, "both wall triangles are queued");
+
+    check(culler.isVisible(glm::vec3(-1.0f, -1.0f, -6.0f), glm::vec3(1.0f, 1.0f, -5.0f)), "a box in front of the wall is visible");
+    check(!culler.isVisible(glm::vec3(-1.0f, -1.0f, -15.0f), glm::vec3(1.0f, 1.0f, -14.0f)), "a box behind the wall is hidden");
+    check(culler.isVisible(glm::vec3(-1.0f, -1.0f, -11.0f), glm::vec3(1.0f, 1.0f, -9.0f)), "a box straddling the wall is visible");
+    check(culler.isVisible(glm::vec3(10.0f, -1.0f, -15.0f), glm::vec3(12.0f, 1.0f, -14.0f)), "a box beside the wall is visible");
+    check(culler.isVisible(glm::vec3(4.0f, -1.0f, -15.0f), glm::vec3(9.0f, 1.0f, -14.0f)),
+          "a box behind the wall but reaching past its edge is visible");
+    check(culler.isVisible(glm::vec3(-1.0f, -1.0f, 1.0f), glm::vec3(1.0f, 1.0f, 2.0f)), "a box behind the camera is left visible");
+}
+
+void testBackFacingWall()
+{
+    OcclusionCuller culler;
+    render(culler, true);
+    check(culler.getStats().triangles == 0, "back facing triangles are dropped");
+    check(culler.isVisible(glm::vec3(-1.0f, -1.0f, -15.0f), glm::vec3(1.0f, 1.0f, -14.0f)),
+          "a box behind a back facing wall is visible");
+}
+
+}
+
+int main()
+{
+    testFrontFacingWall();
+    testBackFacingWall();
+
+    if (failures == 0) std::cout << "All occlusion culler tests passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
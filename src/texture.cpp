@@ -1,7 +1,66 @@
 #include "texture.h"
 
-Texture::Texture(const char* imagePath, GLuint colorMode, bool gammaCorrect)
+#include "glExtensions.h"
+
+TextureCompression Texture::compression = TextureCompression::FAST;
+
+/**
+ * @brief Loads a texture and its mip chain through the texture cache. Safe to call
+ * from any thread once the GL extensions have been loaded.
+ */
+PreparedTexture Texture::prepare(const string &imagePath, bool gammaCorrect, bool normalMap)
+{
+    PreparedTexture prepared;
+    prepared.imagePath = imagePath;
+    prepared.gammaCorrect = gammaCorrect;
+    prepared.normalMap = normalMap;
+
+    // BC5 is core, BC1 and BC3 need S3TC
+    bool compress = compression != TextureCompression::NONE && (normalMap || glExtensions.textureCompressionS3TC);
+    CompressionQuality quality = compression == TextureCompression::HIGH_QUALITY 
+        ? CompressionQuality::HIGH : CompressionQuality::FAST;
+    MipFilter filter = normalMap ? MipFilter::NORMAL_MAP : gammaCorrect ? MipFilter::SRGB : MipFilter::LINEAR;
+
+    prepared.loaded = loadTextureData(imagePath, filter, compress, quality, prepared.data);
+    return prepared;
+}
+
+Texture::Texture(const char* imagePath, bool gammaCorrect, bool normalMap)
+{
+    std::cout << "Loading texture at" << imagePath << std::endl;
+    upload(prepare(imagePath, gammaCorrect, normalMap));
+}
+
+Texture::Texture(const PreparedTexture &prepared)
 {
+    upload(prepared);
+}
+
+GLenum Texture::internalFormat(const PreparedTexture &prepared)
+{
+    const TextureData &data = prepared.data;
+    if (!data.compressed) return prepared.gammaCorrect ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+
+    switch (data.format) {
+        case BlockFormat::BC1:
+            return prepared.gammaCorrect ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BlockFormat::BC3:
+            return prepared.gammaCorrect ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BlockFormat::BC5:
+        default:
+            return GL_COMPRESSED_RG_RGTC2;
+    }
+}
+
+/**
+ * @brief Uploads the prepared mip chain level by level.
+ */
+void Texture::upload(const PreparedTexture &prepared)
+{
+    imagePath = prepared.imagePath;
+    gammaCorrect = prepared.gammaCorrect;
+    normalMap = prepared.normalMap;
+
     glGenTextures(1, &ID);
     glBindTexture(GL_TEXTURE_2D, ID);
 
@@ -11,25 +70,28 @@ Texture::Texture(const char* imagePath, GLuint colorMode, bool gammaCorrect)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // stbi config
-    // image coords are different to gl coords, so flip image
-    stbi_set_flip_vertically_on_load(true);  
+    if (!prepared.loaded) {
+        std::cout << "Failed to load texture at" << prepared.imagePath << std::endl;
+        return;
+    }
 
-    // load and generate the texture
-    int width, height, nrChannels;
-    std::cout << "Loading texture at" << imagePath << std::endl;
-    unsigned char *data = stbi_load(imagePath, &width, &height, &nrChannels, 0);
-    if (data) {
-        glTexImage2D(GL_TEXTURE_2D, 0, gammaCorrect ? GL_SRGB : GL_RGB, width, height, 0, colorMode, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    } else {
-        std::cout << "Failed to load texture at" << imagePath << std::endl;
+    const TextureData &data = prepared.data;
+    GLenum format = internalFormat(prepared);
+    for (unsigned int i = 0; i < data.levels.size(); i++) {
+        const TextureLevel &level = data.levels[i];
+        if (data.compressed) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, format, level.width, level.height, 0, 
+                                   level.size, level.data);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, i, format, level.width, level.height, 0, 
+                         GL_RGBA, GL_UNSIGNED_BYTE, level.data);
+        }
     }
-    stbi_image_free(data); 
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, data.levels.size() - 1);
 }
 
 void Texture::bind(GLuint textureSlot)
 {
     glActiveTexture(textureSlot);
     glBindTexture(GL_TEXTURE_2D, ID);
-}
\ No newline at end of file
+}
@@ -5,7 +5,26 @@
 #include <fstream>
 #include <sstream>
 
-#include <stb_image.h>
+#include "textureCache.h"
+
+enum class TextureCompression {
+    NONE,
+    FAST,
+    HIGH_QUALITY,
+};
+
+/**
+ * @brief A texture loaded into CPU memory with its mip chain, waiting for upload.
+ * Preparing doesn't touch GL, so it can run on worker threads.
+ */
+struct PreparedTexture {
+    string imagePath;
+    bool gammaCorrect { false };
+    bool normalMap { false };
+    // false if the image could not be loaded
+    bool loaded { false };
+    TextureData data;
+};
 
 class Texture
 {
@@ -13,9 +32,24 @@ public:
     unsigned int ID;
     string type;
     string path;
+    // The source, so the texture can be prepared again - see TextureArrays
+    string imagePath;
+    bool gammaCorrect { false };
+    bool normalMap { false };
+
+    // Block compress textures through the on-disk texture cache, where supported
+    static TextureCompression compression;
+
+    static PreparedTexture prepare(const string &imagePath, bool gammaCorrect, bool normalMap = false);
+    // The GL format a prepared texture uploads as
+    static GLenum internalFormat(const PreparedTexture &prepared);
   
-    Texture(const char* imagePath, GLuint colorMode, bool gammaCorrect);
+    Texture(const char* imagePath, bool gammaCorrect, bool normalMap = false);
+    Texture(const PreparedTexture &prepared);
     void bind(GLuint textureSlot);
+
+private:
+    void upload(const PreparedTexture &prepared);
 };
   
 
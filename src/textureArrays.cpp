@@ -0,0 +1,222 @@
+#include "textureArrays.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <tuple>
+
+#include "jobs.h"
+#include "texture.h"
+
+namespace {
+
+// Textures which can share an array
+struct ArrayKey {
+    int width;
+    int height;
+    GLenum format;
+    unsigned int levels;
+
+    bool operator<(const ArrayKey &other) const {
+        return std::tie(width, height, format, levels) < std::tie(other.width, other.height, other.format, other.levels);
+    }
+};
+
+bool isTiny(const PreparedTexture &prepared, int size)
+{
+    const TextureLevel &base = prepared.data.levels[0];
+    return base.width <= size && base.height <= size;
+}
+
+/**
+ * @brief Replaces a tiny texture with a plain RGBA8 copy scaled up to `size` with nearest
+ * sampling, so it still tiles like the original, and gives it a fresh mip chain.
+ */
+void padTiny(PreparedTexture &prepared, int size)
+{
+    const TextureData &data = prepared.data;
+    const TextureLevel &base = data.levels[0];
+    ImageRGBA image;
+    if (data.compressed) {
+        image = decompressImage(base.data, base.width, base.height, data.format);
+    } else {
+        image = ImageRGBA(base.width, base.height);
+        std::copy(base.data, base.data + base.size, image.pixels.begin());
+    }
+
+    ImageRGBA padded(size, size);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++)
+            memcpy(padded.at(x, y), image.at(x * image.width / size, y * image.height / size), 4);
+    }
+
+    MipFilter filter = prepared.normalMap ? MipFilter::NORMAL_MAP : prepared.gammaCorrect ? MipFilter::SRGB : MipFilter::LINEAR;
+    vector<ImageRGBA> mips = generateMipChain(padded, filter);
+
+    TextureData result;
+    result.compressed = false;
+    for (const ImageRGBA &mip : mips)
+        result.storage.insert(result.storage.end(), mip.pixels.begin(), mip.pixels.end());
+    size_t offset = 0;
+    for (const ImageRGBA &mip : mips) {
+        result.levels.push_back({ mip.width, mip.height, result.storage.data() + offset, mip.pixels.size() });
+        offset += mip.pixels.size();
+    }
+    prepared.data = std::move(result);
+}
+
+/**
+ * @brief Creates an array from `count` textures of the same key, a layer each in order,
+ * sampled the same way as Texture.
+ */
+unsigned int createArray(const vector<PreparedTexture> &prepared, const unsigned int *members, unsigned int count)
+{
+    const PreparedTexture &first = prepared[members[0]];
+    const bool compressed = first.data.compressed;
+    const GLenum format = Texture::internalFormat(first);
+
+    unsigned int array;
+    glGenTextures(1, &array);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // Allocate every level for all the layers, then fill them in
+    for (unsigned int i = 0; i < first.data.levels.size(); i++) {
+        const TextureLevel &level = first.data.levels[i];
+        if (compressed) {
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, i, format, level.width, level.height, count, 0,
+                                   level.size * count, nullptr);
+        } else {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, i, format, level.width, level.height, count, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+    }
+    for (unsigned int layer = 0; layer < count; layer++) {
+        const TextureData &data = prepared[members[layer]].data;
+        for (unsigned int i = 0; i < data.levels.size(); i++) {
+            const TextureLevel &level = data.levels[i];
+            if (compressed) {
+                glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, layer, level.width, level.height, 1,
+                                          format, level.size, level.data);
+            } else {
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, layer, level.width, level.height, 1,
+                                GL_RGBA, GL_UNSIGNED_BYTE, level.data);
+            }
+        }
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, first.data.levels.size() - 1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return array;
+}
+
+}
+
+/**
+ * @brief Prepares the textures again through the texture cache - a mapped file per texture
+ * once it is warm - in parallel on the job pool, then uploads them to their arrays.
+ */
+void TextureArrays::pack(const vector<shared_ptr<Material>> &materials)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // The materials still to pack, and the distinct textures they use
+    vector<Material*> pending;
+    vector<const MaterialTexture*> sources;
+    for (const shared_ptr<Material> &material : materials) {
+        if (!material || material->isPacked()) continue;
+        pending.push_back(material.get());
+        for (int slot = 0; slot < Material::SLOT_COUNT; slot++) {
+            const MaterialTexture &texture = material->getTexture(slot);
+            if (!texture.texture) continue;
+            auto found = std::find_if(sources.begin(), sources.end(), [&](const MaterialTexture *source) {
+                return source->texture == texture.texture;
+            });
+            if (found == sources.end()) sources.push_back(&texture);
+        }
+    }
+    if (pending.empty()) return;
+
+    // One texture per job
+    vector<PreparedTexture> prepared(sources.size());
+    vector<uint8_t> tiny(sources.size(), false);
+    JobSystem::instance().parallelFor(sources.size(), 1, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            const MaterialTexture &source = *sources[i];
+            if (source.imagePath.empty()) continue;
+            prepared[i] = Texture::prepare(source.imagePath, source.gammaCorrect, source.normalMap);
+            if (prepared[i].loaded && isTiny(prepared[i], TINY_SIZE)) {
+                padTiny(prepared[i], TINY_SIZE);
+                tiny[i] = true;
+            }
+        }
+    });
+
+    std::map<ArrayKey, vector<unsigned int>> groups;
+    for (unsigned int i = 0; i < prepared.size(); i++) {
+        if (!prepared[i].loaded) continue;
+        const TextureLevel &base = prepared[i].data.levels[0];
+        ArrayKey key { base.width, base.height, Texture::internalFormat(prepared[i]), (unsigned int)prepared[i].data.levels.size() };
+        groups[key].push_back(i);
+    }
+
+    // Groups larger than the layer limit are split over several arrays
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    vector<unsigned int> arrayOf(sources.size(), 0), layerOf(sources.size(), 0);
+    for (const auto &group : groups) {
+        const vector<unsigned int> &members = group.second;
+        for (unsigned int first = 0; first < members.size(); first += maxLayers) {
+            unsigned int count = std::min((unsigned int)maxLayers, (unsigned int)members.size() - first);
+            unsigned int array = createArray(prepared, members.data() + first, count);
+            _arrays.push_back(array);
+            _stats.arrays++;
+            for (unsigned int layer = 0; layer < count; layer++) {
+                arrayOf[members[first + layer]] = array;
+                layerOf[members[first + layer]] = layer;
+            }
+        }
+    }
+
+    for (Material *material : pending) {
+        unsigned int arrays[Material::SLOT_COUNT] = {}, layers[Material::SLOT_COUNT] = {};
+        bool complete = true;
+        for (int slot = 0; slot < Material::SLOT_COUNT; slot++) {
+            const MaterialTexture &texture = material->getTexture(slot);
+            if (!texture.texture) continue;
+            auto found = std::find_if(sources.begin(), sources.end(), [&](const MaterialTexture *source) {
+                return source->texture == texture.texture;
+            });
+            unsigned int index = found - sources.begin();
+            complete = complete && prepared[index].loaded;
+            arrays[slot] = arrayOf[index];
+            layers[slot] = layerOf[index];
+        }
+        if (!complete) continue;
+        material->setArrayLayers(arrays, layers);
+        _stats.materials++;
+    }
+
+    for (unsigned int i = 0; i < prepared.size(); i++) {
+        if (!prepared[i].loaded) continue;
+        _stats.textures++;
+        if (tiny[i]) _stats.tinyTextures++;
+    }
+
+    float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Packed " << _stats.textures << " textures (" << _stats.tinyTextures << " tiny) of "
+              << _stats.materials << " materials into " << _stats.arrays << " arrays in " << seconds << "s" << std::endl;
+}
+
+void TextureArrays::release()
+{
+    if (_arrays.empty()) return;
+    glDeleteTextures(_arrays.size(), _arrays.data());
+    _arrays.clear();
+    _stats = Stats();
+    // Deleted names can be reused
+    Material::resetArrayBindings();
+}
@@ -0,0 +1,53 @@
+#ifndef __TEXTUREARRAYS__
+#define __TEXTUREARRAYS__
+
+#include "global.h"
+
+#include "material.h"
+
+/**
+ * @brief Packs material textures into GL_TEXTURE_2D_ARRAYs, so meshes with different
+ * materials can be drawn without rebinding textures between them.
+ *
+ * Textures of the same size, format and mip count share an array, one texture per layer.
+ * Textures of at most TINY_SIZE pixels - placeholders like res/pixel.png - are decoded,
+ * scaled up to TINY_SIZE and padded into one shared RGBA8 array (one for sRGB, one for
+ * linear), rather than each getting an array of its own.
+ *
+ * Packing is optional and copies the textures: materials keep their 2D textures for
+ * programs without the TEXTURE_ARRAYS path. The arrays belong to this object and must
+ * outlive every draw of the materials packed into them.
+ */
+class TextureArrays
+{
+public:
+    static const int TINY_SIZE = 16;
+
+    struct Stats {
+        unsigned int materials { 0 };
+        unsigned int textures { 0 };
+        unsigned int arrays { 0 };
+        // Textures which went into the shared tiny arrays
+        unsigned int tinyTextures { 0 };
+    };
+
+    TextureArrays() {}
+    TextureArrays(const TextureArrays&) = delete;
+    TextureArrays& operator=(const TextureArrays&) = delete;
+
+    /**
+     * @brief Packs the textures of every material not packed yet. Materials with a texture
+     * that failed to load stay unpacked.
+     */
+    void pack(const vector<shared_ptr<Material>> &materials);
+    // Deletes the arrays
+    void release();
+
+    const Stats& getStats() const { return _stats; }
+
+private:
+    vector<unsigned int> _arrays;
+    Stats _stats;
+};
+
+#endif /* __TEXTUREARRAYS__ */
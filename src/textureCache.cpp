@@ -0,0 +1,298 @@
+#include "textureCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char *TEXTURE_CACHE_DIRECTORY = "../cache/textures/";
+
+//
+// DDS file layout, see https://learn.microsoft.com/en-us/windows/win32/direct3ddds/dds-header
+//
+const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+const uint32_t DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000;
+const uint32_t DDSD_PITCH = 0x8, DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000;
+const uint32_t DDPF_ALPHAPIXELS = 0x1, DDPF_FOURCC = 0x4, DDPF_RGB = 0x40;
+// RGBA8 in memory order
+const uint32_t RGBA8_MASKS[4] = { 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000 };
+const uint32_t DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+
+constexpr uint32_t fourCC(char a, char b, char c, char d) {
+    return (uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24);
+}
+
+struct DDSPixelFormat {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask, gBitMask, bBitMask, aBitMask;
+};
+
+struct DDSHeader {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DDSPixelFormat pixelFormat;
+    uint32_t caps, caps2, caps3, caps4;
+    uint32_t reserved2;
+};
+static_assert(sizeof(DDSHeader) == 124, "DDS header must be 124 bytes");
+
+uint32_t formatFourCC(BlockFormat format) {
+    switch (format) {
+        case BlockFormat::BC1: return fourCC('D', 'X', 'T', '1');
+        case BlockFormat::BC3: return fourCC('D', 'X', 'T', '5');
+        case BlockFormat::BC5: return fourCC('A', 'T', 'I', '2');
+    }
+    return 0;
+}
+
+bool fourCCFormat(uint32_t code, BlockFormat &format) {
+    for (BlockFormat candidate : { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC5 }) {
+        if (formatFourCC(candidate) == code) {
+            format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t levelSize(const TextureData &texture, int width, int height) {
+    return texture.compressed ? compressedSize(texture.format, width, height) : (size_t)width * height * 4;
+}
+
+string cacheVariant(MipFilter filter, bool compress, CompressionQuality quality) {
+    string variant = filter == MipFilter::NORMAL_MAP ? "normal" : filter == MipFilter::SRGB ? "srgb" : "linear";
+    if (!compress) return variant + ".rgba";
+    return variant + (quality == CompressionQuality::HIGH ? ".hq" : ".fast");
+}
+
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    if (_mapped) munmap((void*)_data, _size);
+#endif
+}
+
+bool MappedFile::open(const string &path)
+{
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void *address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            _data = (const unsigned char*)address;
+            _size = info.st_size;
+            _mapped = true;
+        }
+    }
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    return _mapped;
+#else
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    _buffer.resize(length > 0 ? length : 0);
+    bool ok = length > 0 && fread(_buffer.data(), 1, _buffer.size(), file) == _buffer.size();
+    fclose(file);
+
+    _data = _buffer.data();
+    _size = ok ? _buffer.size() : 0;
+    return ok;
+#endif
+}
+
+string textureCachePath(const string &imagePath, const string &variant) {
+    string name = imagePath;
+    for (char &c : name) {
+        if (!isalnum((unsigned char)c) && c != '.' && c != '-') c = '_';
+    }
+    return TEXTURE_CACHE_DIRECTORY + name + "." + variant + ".dds";
+}
+
+bool writeDDS(const string &path, const TextureData &texture) {
+    if (texture.levels.empty()) return false;
+
+    std::error_code error;
+    fs::create_directories(fs::path(path).parent_path(), error);
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cout << "ERROR::TEXTURECACHE::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+
+    DDSHeader header;
+    memset(&header, 0, sizeof(header));
+    header.size = sizeof(DDSHeader);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT
+                 | (texture.compressed ? DDSD_LINEARSIZE : DDSD_PITCH);
+    header.width = texture.levels[0].width;
+    header.height = texture.levels[0].height;
+    header.pitchOrLinearSize = texture.compressed ? texture.levels[0].size : texture.levels[0].width * 4;
+    header.mipMapCount = texture.levels.size();
+    header.pixelFormat.size = sizeof(DDSPixelFormat);
+    if (texture.compressed) {
+        header.pixelFormat.flags = DDPF_FOURCC;
+        header.pixelFormat.fourCC = formatFourCC(texture.format);
+    } else {
+        header.pixelFormat.flags = DDPF_RGB | DDPF_ALPHAPIXELS;
+        header.pixelFormat.rgbBitCount = 32;
+        header.pixelFormat.rBitMask = RGBA8_MASKS[0];
+        header.pixelFormat.gBitMask = RGBA8_MASKS[1];
+        header.pixelFormat.bBitMask = RGBA8_MASKS[2];
+        header.pixelFormat.aBitMask = RGBA8_MASKS[3];
+    }
+    header.caps = DDSCAPS_TEXTURE | (texture.levels.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+    bool ok = fwrite(&DDS_MAGIC, sizeof(DDS_MAGIC), 1, file) == 1
+           && fwrite(&header, sizeof(header), 1, file) == 1;
+    for (const TextureLevel &level : texture.levels) {
+        ok = ok && fwrite(level.data, 1, level.size, file) == level.size;
+    }
+    fclose(file);
+
+    if (!ok) {
+        std::cout << "ERROR::TEXTURECACHE::CANNOT_WRITE " << path << std::endl;
+        remove(path.c_str());
+    }
+    return ok;
+}
+
+bool readDDS(const string &path, TextureData &texture)
+{
+    auto mapping = std::make_shared<MappedFile>();
+    if (!mapping->open(path)) return false;
+
+    const size_t dataOffset = sizeof(uint32_t) + sizeof(DDSHeader);
+    uint32_t magic = 0;
+    DDSHeader header;
+    bool ok = mapping->size() >= dataOffset;
+    if (ok) {
+        memcpy(&magic, mapping->data(), sizeof(magic));
+        memcpy(&header, mapping->data() + sizeof(magic), sizeof(header));
+        ok = magic == DDS_MAGIC && header.size == sizeof(DDSHeader);
+    }
+
+    if (ok && (header.pixelFormat.flags & DDPF_FOURCC)) {
+        texture.compressed = true;
+        ok = fourCCFormat(header.pixelFormat.fourCC, texture.format);
+    } else if (ok) {
+        texture.compressed = false;
+        ok = (header.pixelFormat.flags & DDPF_RGB) && header.pixelFormat.rgbBitCount == 32
+          && header.pixelFormat.rBitMask == RGBA8_MASKS[0] && header.pixelFormat.gBitMask == RGBA8_MASKS[1]
+          && header.pixelFormat.bBitMask == RGBA8_MASKS[2] && header.pixelFormat.aBitMask == RGBA8_MASKS[3];
+    }
+
+    // Levels point straight into the mapping
+    texture.levels.clear();
+    texture.storage.clear();
+    int width = header.width, height = header.height;
+    size_t offset = dataOffset;
+    unsigned int levelCount = ok ? std::max(header.mipMapCount, 1u) : 0;
+    for (unsigned int i = 0; i < levelCount && ok; i++) {
+        size_t size = levelSize(texture, width, height);
+        ok = offset + size <= mapping->size();
+        texture.levels.push_back({ width, height, mapping->data() + offset, size });
+
+        offset += size;
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+
+    if (!ok) {
+        std::cout << "ERROR::TEXTURECACHE::INVALID_FILE " << path << std::endl;
+        texture.levels.clear();
+        return false;
+    }
+    texture.mapping = mapping;
+    return true;
+}
+
+bool loadTextureData(const string &imagePath, MipFilter filter, bool compress, CompressionQuality quality,
+                     TextureData &texture, bool rebuild)
+{
+    string cachePath = textureCachePath(imagePath, cacheVariant(filter, compress, quality));
+
+    // Use the cache if it is at least as new as the source image
+    std::error_code error;
+    if (!rebuild && fs::exists(cachePath, error)
+        && fs::last_write_time(cachePath, error) >= fs::last_write_time(imagePath, error)
+        && readDDS(cachePath, texture)) {
+        return true;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    ImageRGBA image;
+    int channels;
+    if (!loadImage(imagePath.c_str(), image, &channels)) return false;
+
+    texture.compressed = compress;
+    texture.format = filter == MipFilter::NORMAL_MAP ? BlockFormat::BC5 : channels == 4 ? BlockFormat::BC3 : BlockFormat::BC1;
+    texture.mapping.reset();
+
+    vector<ImageRGBA> mips = generateMipChain(image, filter);
+
+    // Encode every level into one block of storage, then point the levels into it
+    vector<vector<unsigned char>> encoded;
+    size_t totalSize = 0;
+    for (ImageRGBA &mip : mips) {
+        encoded.push_back(compress ? compressImage(mip, texture.format, quality) : std::move(mip.pixels));
+        totalSize += encoded.back().size();
+    }
+
+    texture.storage.clear();
+    texture.storage.reserve(totalSize);
+    for (const vector<unsigned char> &level : encoded)
+        texture.storage.insert(texture.storage.end(), level.begin(), level.end());
+
+    texture.levels.clear();
+    size_t offset = 0;
+    for (unsigned int i = 0; i < mips.size(); i++) {
+        texture.levels.push_back({ mips[i].width, mips[i].height, texture.storage.data() + offset, encoded[i].size() });
+        offset += encoded[i].size();
+    }
+
+    float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    if (compress) {
+        ImageRGBA decoded = decompressImage(texture.levels[0].data, image.width, image.height, texture.format);
+        float psnr = computePSNR(image, decoded, texture.format);
+        std::cout << "Compressed " << imagePath << " to " << blockFormatName(texture.format)
+                  << (quality == CompressionQuality::HIGH ? " (high quality)" : " (fast)")
+                  << ": PSNR " << psnr << " dB, " << mips.size() << " mips, " << seconds << "s" << std::endl;
+    } else {
+        std::cout << "Generated " << mips.size() << " mips for " << imagePath << " in " << seconds << "s" << std::endl;
+    }
+
+    writeDDS(cachePath, texture);
+    return true;
+}
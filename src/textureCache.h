@@ -0,0 +1,96 @@
+#ifndef __TEXTURECACHE__
+#define __TEXTURECACHE__
+
+#include "global.h"
+
+#include "textureCompressor.h"
+
+/**
+ * @file textureCache.h
+ * @brief On-disk cache of textures with their full mip chains, stored as DDS files so
+ * they can be memory mapped and uploaded level by level without any processing.
+ *
+ * Textures are either block compressed or plain RGBA8. Nothing here touches GL, so
+ * textures can be prepared on worker threads.
+ */
+
+/**
+ * @brief A read only file mapped into memory. Falls back to reading the whole file
+ * where mapping isn't available.
+ */
+class MappedFile
+{
+public:
+    MappedFile() {}
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const string &path);
+
+    const unsigned char* data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    const unsigned char *_data { nullptr };
+    size_t _size { 0 };
+    bool _mapped { false };
+    vector<unsigned char> _buffer;
+};
+
+/**
+ * @brief One mip level. `data` points into the owning TextureData.
+ */
+struct TextureLevel {
+    int width;
+    int height;
+    const unsigned char *data;
+    size_t size;
+};
+
+/**
+ * @brief A texture with its complete mip chain, ready for upload.
+ *
+ * Levels live either in a mapped cache file or in `storage`, so this can be moved
+ * but not copied.
+ */
+struct TextureData {
+    // Otherwise RGBA8
+    bool compressed { false };
+    BlockFormat format { BlockFormat::BC1 };
+    vector<TextureLevel> levels;
+
+    shared_ptr<MappedFile> mapping;
+    vector<unsigned char> storage;
+
+    TextureData() {}
+    TextureData(TextureData&&) = default;
+    TextureData& operator=(TextureData&&) = default;
+    TextureData(const TextureData&) = delete;
+    TextureData& operator=(const TextureData&) = delete;
+};
+
+/**
+ * @brief Path of the cache file for an image. `variant` distinguishes different
+ * encodings of the same source image.
+ */
+string textureCachePath(const string &imagePath, const string &variant);
+
+bool writeDDS(const string &path, const TextureData &texture);
+bool readDDS(const string &path, TextureData &texture);
+
+/**
+ * @brief Loads an image with its mip chain, from the cache if it is newer than the
+ * image, otherwise generating the mips and writing the cache.
+ *
+ * Mips are filtered with `filter`. When compressing, normal maps go to BC5, images with
+ * alpha to BC3 and everything else to BC1, and the PSNR of newly compressed textures is
+ * logged.
+ *
+ * @param rebuild Ignore any existing cache entry.
+ * @return false if the image could not be loaded.
+ */
+bool loadTextureData(const string &imagePath, MipFilter filter, bool compress, CompressionQuality quality,
+                     TextureData &texture, bool rebuild = false);
+
+#endif /* __TEXTURECACHE__ */
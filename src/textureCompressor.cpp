@@ -0,0 +1,414 @@
+#include "textureCompressor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cfloat>
+
+namespace {
+
+//
+// BC1 colour blocks
+//
+
+uint16_t packColor565(glm::vec3 color) {
+    int r = glm::clamp((int)(color.r * 31.0f / 255.0f + 0.5f), 0, 31);
+    int g = glm::clamp((int)(color.g * 63.0f / 255.0f + 0.5f), 0, 63);
+    int b = glm::clamp((int)(color.b * 31.0f / 255.0f + 0.5f), 0, 31);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+glm::ivec3 unpackColor565(uint16_t color) {
+    int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    return glm::ivec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+}
+
+// Palette as decoded by the GPU, in BC1 index order
+void colorPalette(uint16_t c0, uint16_t c1, bool fourColor, glm::ivec3 palette[4]) {
+    palette[0] = unpackColor565(c0);
+    palette[1] = unpackColor565(c1);
+    if (fourColor) {
+        palette[2] = (2 * palette[0] + palette[1]) / 3;
+        palette[3] = (palette[0] + 2 * palette[1]) / 3;
+    } else {
+        palette[2] = (palette[0] + palette[1]) / 2;
+        palette[3] = glm::ivec3(0);
+    }
+}
+
+int colorDistance(glm::ivec3 a, glm::ivec3 b) {
+    glm::ivec3 d = a - b;
+    return d.x * d.x + d.y * d.y + d.z * d.z;
+}
+
+/**
+ * @brief Picks the nearest palette entry for every pixel.
+ *
+ * @return Total squared error of the block.
+ */
+int assignColorIndices(const glm::vec3 colors[16], uint16_t c0, uint16_t c1, uint32_t &indices) {
+    glm::ivec3 palette[4];
+    colorPalette(c0, c1, true, palette);
+
+    int error = 0;
+    indices = 0;
+    for (int i = 0; i < 16; i++) {
+        glm::ivec3 color = glm::ivec3(colors[i] + 0.5f);
+        int best = 0, bestDistance = INT32_MAX;
+        for (int p = 0; p < 4; p++) {
+            int distance = colorDistance(color, palette[p]);
+            if (distance < bestDistance) {
+                best = p;
+                bestDistance = distance;
+            }
+        }
+        indices |= (uint32_t)best << (2 * i);
+        error += bestDistance;
+    }
+    return error;
+}
+
+// Moves endpoints 1/16th of the range towards each other, which reduces error for most blocks
+void insetEndpoints(glm::vec3 &e0, glm::vec3 &e1) {
+    glm::vec3 inset = (e0 - e1) / 16.0f;
+    e0 = glm::clamp(e0 - inset, 0.0f, 255.0f);
+    e1 = glm::clamp(e1 + inset, 0.0f, 255.0f);
+}
+
+void boundingBoxEndpoints(const glm::vec3 colors[16], glm::vec3 &e0, glm::vec3 &e1) {
+    e0 = e1 = colors[0];
+    for (int i = 1; i < 16; i++) {
+        e0 = glm::max(e0, colors[i]);
+        e1 = glm::min(e1, colors[i]);
+    }
+    insetEndpoints(e0, e1);
+}
+
+void principalAxisEndpoints(const glm::vec3 colors[16], glm::vec3 &e0, glm::vec3 &e1) {
+    glm::vec3 mean(0.0f);
+    for (int i = 0; i < 16; i++) mean += colors[i];
+    mean /= 16.0f;
+
+    // Covariance matrix
+    float cov[6] = { 0 };
+    for (int i = 0; i < 16; i++) {
+        glm::vec3 d = colors[i] - mean;
+        cov[0] += d.r * d.r; cov[1] += d.r * d.g; cov[2] += d.r * d.b;
+        cov[3] += d.g * d.g; cov[4] += d.g * d.b; cov[5] += d.b * d.b;
+    }
+
+    // Power iteration for the principal axis
+    glm::vec3 axis(1.0f, 1.0f, 1.0f);
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 next(
+            cov[0] * axis.r + cov[1] * axis.g + cov[2] * axis.b,
+            cov[1] * axis.r + cov[3] * axis.g + cov[4] * axis.b,
+            cov[2] * axis.r + cov[4] * axis.g + cov[5] * axis.b
+        );
+        float length = glm::length(next);
+        if (length < FLT_EPSILON) break;
+        axis = next / length;
+    }
+
+    float minProj = FLT_MAX, maxProj = -FLT_MAX;
+    for (int i = 0; i < 16; i++) {
+        float proj = glm::dot(colors[i] - mean, axis);
+        minProj = std::min(minProj, proj);
+        maxProj = std::max(maxProj, proj);
+    }
+    e0 = glm::clamp(mean + axis * maxProj, 0.0f, 255.0f);
+    e1 = glm::clamp(mean + axis * minProj, 0.0f, 255.0f);
+    insetEndpoints(e0, e1);
+}
+
+/**
+ * @brief Solves for the endpoints which minimise squared error given fixed indices.
+ */
+bool refineEndpoints(const glm::vec3 colors[16], uint32_t indices, glm::vec3 &e0, glm::vec3 &e1) {
+    const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+    float aa = 0, ab = 0, bb = 0;
+    glm::vec3 ax(0.0f), bx(0.0f);
+    for (int i = 0; i < 16; i++) {
+        float a = weights[(indices >> (2 * i)) & 3];
+        float b = 1.0f - a;
+        aa += a * a; ab += a * b; bb += b * b;
+        ax += a * colors[i];
+        bx += b * colors[i];
+    }
+
+    float det = aa * bb - ab * ab;
+    if (fabs(det) < FLT_EPSILON) return false;
+
+    e0 = glm::clamp((ax * bb - bx * ab) / det, 0.0f, 255.0f);
+    e1 = glm::clamp((bx * aa - ax * ab) / det, 0.0f, 255.0f);
+    return true;
+}
+
+/**
+ * @brief Writes a 4-colour mode block (c0 > c1), which is also what BC3 colour blocks use.
+ */
+void writeColorBlock(uint16_t c0, uint16_t c1, uint32_t indices, unsigned char *out) {
+    if (c0 < c1) {
+        // Swap endpoints: index 0 <-> 1, 2 <-> 3
+        std::swap(c0, c1);
+        indices ^= 0x55555555;
+    } else if (c0 == c1) {
+        indices = 0;
+    }
+
+    out[0] = c0 & 0xff; out[1] = c0 >> 8;
+    out[2] = c1 & 0xff; out[3] = c1 >> 8;
+    for (int i = 0; i < 4; i++) out[4 + i] = (indices >> (8 * i)) & 0xff;
+}
+
+void compressColorBlock(const glm::vec3 colors[16], CompressionQuality quality, unsigned char *out) {
+    glm::vec3 e0, e1;
+    boundingBoxEndpoints(colors, e0, e1);
+
+    uint16_t c0 = packColor565(e0), c1 = packColor565(e1);
+    uint32_t indices;
+    int error = assignColorIndices(colors, c0, c1, indices);
+
+    if (quality == CompressionQuality::HIGH && error > 0) {
+        principalAxisEndpoints(colors, e0, e1);
+        uint16_t pc0 = packColor565(e0), pc1 = packColor565(e1);
+        uint32_t pIndices;
+        int pError = assignColorIndices(colors, pc0, pc1, pIndices);
+
+        for (int iteration = 0; iteration < 2 && pError > 0; iteration++) {
+            if (!refineEndpoints(colors, pIndices, e0, e1)) break;
+            uint16_t rc0 = packColor565(e0), rc1 = packColor565(e1);
+            uint32_t rIndices;
+            int rError = assignColorIndices(colors, rc0, rc1, rIndices);
+            if (rError >= pError) break;
+            pc0 = rc0; pc1 = rc1; pIndices = rIndices; pError = rError;
+        }
+
+        if (pError < error) {
+            c0 = pc0; c1 = pc1; indices = pIndices; error = pError;
+        }
+    }
+
+    writeColorBlock(c0, c1, indices, out);
+}
+
+//
+// BC4 single channel blocks (BC3 alpha, BC5 red/green)
+//
+
+void channelPalette(int a0, int a1, int palette[8]) {
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1) {
+        for (int i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+    } else {
+        for (int i = 1; i < 5; i++) palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+int assignChannelIndices(const unsigned char values[16], int a0, int a1, uint64_t &indices) {
+    int palette[8];
+    channelPalette(a0, a1, palette);
+
+    int error = 0;
+    indices = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = 0, bestDistance = INT32_MAX;
+        for (int p = 0; p < 8; p++) {
+            int d = values[i] - palette[p];
+            if (d * d < bestDistance) {
+                best = p;
+                bestDistance = d * d;
+            }
+        }
+        indices |= (uint64_t)best << (3 * i);
+        error += bestDistance;
+    }
+    return error;
+}
+
+void compressChannelBlock(const unsigned char values[16], CompressionQuality quality, unsigned char *out) {
+    int minValue = 255, maxValue = 0;
+    for (int i = 0; i < 16; i++) {
+        minValue = std::min(minValue, (int)values[i]);
+        maxValue = std::max(maxValue, (int)values[i]);
+    }
+
+    // 8 value mode, interpolating between the extremes
+    int a0 = maxValue, a1 = minValue;
+    uint64_t indices;
+    int error = assignChannelIndices(values, a0, a1, indices);
+
+    if (quality == CompressionQuality::HIGH && error > 0) {
+        // 6 value mode with explicit 0 and 255 - better when the block has outliers at the extremes
+        int innerMin = 255, innerMax = 0;
+        for (int i = 0; i < 16; i++) {
+            if (values[i] == 0 || values[i] == 255) continue;
+            innerMin = std::min(innerMin, (int)values[i]);
+            innerMax = std::max(innerMax, (int)values[i]);
+        }
+        if (innerMin <= innerMax) {
+            uint64_t sixIndices;
+            int sixError = assignChannelIndices(values, innerMin, innerMax, sixIndices);
+            if (sixError < error) {
+                a0 = innerMin; a1 = innerMax; indices = sixIndices; error = sixError;
+            }
+        }
+
+        // Nudge 8 value mode endpoints inwards
+        for (int inset = 1; inset <= 4 && a0 > a1 && maxValue - minValue > 2 * inset; inset++) {
+            uint64_t insetIndices;
+            int insetError = assignChannelIndices(values, maxValue - inset, minValue + inset, insetIndices);
+            if (insetError < error) {
+                a0 = maxValue - inset; a1 = minValue + inset; indices = insetIndices; error = insetError;
+            }
+        }
+    }
+
+    out[0] = (unsigned char)a0;
+    out[1] = (unsigned char)a1;
+    for (int i = 0; i < 6; i++) out[2 + i] = (indices >> (8 * i)) & 0xff;
+}
+
+void decompressChannelBlock(const unsigned char *block, unsigned char values[16]) {
+    int palette[8];
+    channelPalette(block[0], block[1], palette);
+
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++) indices |= (uint64_t)block[2 + i] << (8 * i);
+    for (int i = 0; i < 16; i++) values[i] = (unsigned char)palette[(indices >> (3 * i)) & 7];
+}
+
+void decompressColorBlock(const unsigned char *block, glm::ivec3 colors[16], bool forceFourColor) {
+    uint16_t c0 = block[0] | (block[1] << 8);
+    uint16_t c1 = block[2] | (block[3] << 8);
+    glm::ivec3 palette[4];
+    colorPalette(c0, c1, forceFourColor || c0 > c1, palette);
+
+    uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+    for (int i = 0; i < 16; i++) colors[i] = palette[(indices >> (2 * i)) & 3];
+}
+
+}
+
+unsigned int blockBytes(BlockFormat format) {
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t compressedSize(BlockFormat format, int width, int height) {
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+const char* blockFormatName(BlockFormat format) {
+    switch (format) {
+        case BlockFormat::BC1: return "BC1";
+        case BlockFormat::BC3: return "BC3";
+        case BlockFormat::BC5: return "BC5";
+    }
+    return "unknown";
+}
+
+vector<unsigned char> compressImage(const ImageRGBA &image, BlockFormat format, CompressionQuality quality) {
+    vector<unsigned char> blocks(compressedSize(format, image.width, image.height));
+    int blocksX = (image.width + 3) / 4, blocksY = (image.height + 3) / 4;
+    unsigned char *out = blocks.data();
+
+    for (int by = 0; by < blocksY; by++) {
+        for (int bx = 0; bx < blocksX; bx++) {
+            // Gather the block, clamping at the image edges
+            unsigned char texels[16][4];
+            for (int i = 0; i < 16; i++) {
+                int x = std::min(bx * 4 + i % 4, image.width - 1);
+                int y = std::min(by * 4 + i / 4, image.height - 1);
+                memcpy(texels[i], image.at(x, y), 4);
+            }
+
+            if (format == BlockFormat::BC5) {
+                unsigned char red[16], green[16];
+                for (int i = 0; i < 16; i++) {
+                    red[i] = texels[i][0];
+                    green[i] = texels[i][1];
+                }
+                compressChannelBlock(red, quality, out);
+                compressChannelBlock(green, quality, out + 8);
+            } else {
+                glm::vec3 colors[16];
+                for (int i = 0; i < 16; i++) colors[i] = glm::vec3(texels[i][0], texels[i][1], texels[i][2]);
+
+                if (format == BlockFormat::BC3) {
+                    unsigned char alpha[16];
+                    for (int i = 0; i < 16; i++) alpha[i] = texels[i][3];
+                    compressChannelBlock(alpha, quality, out);
+                    compressColorBlock(colors, quality, out + 8);
+                } else {
+                    compressColorBlock(colors, quality, out);
+                }
+            }
+
+            out += blockBytes(format);
+        }
+    }
+
+    return blocks;
+}
+
+ImageRGBA decompressImage(const unsigned char *blocks, int width, int height, BlockFormat format) {
+    ImageRGBA image(width, height);
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    const unsigned char *block = blocks;
+
+    for (int by = 0; by < blocksY; by++) {
+        for (int bx = 0; bx < blocksX; bx++) {
+            unsigned char texels[16][4];
+            if (format == BlockFormat::BC5) {
+                unsigned char red[16], green[16];
+                decompressChannelBlock(block, red);
+                decompressChannelBlock(block + 8, green);
+                for (int i = 0; i < 16; i++) {
+                    texels[i][0] = red[i]; texels[i][1] = green[i]; texels[i][2] = 0; texels[i][3] = 255;
+                }
+            } else {
+                unsigned char alpha[16];
+                glm::ivec3 colors[16];
+                if (format == BlockFormat::BC3) {
+                    decompressChannelBlock(block, alpha);
+                    decompressColorBlock(block + 8, colors, true);
+                } else {
+                    std::fill(alpha, alpha + 16, 255);
+                    decompressColorBlock(block, colors, false);
+                }
+                for (int i = 0; i < 16; i++) {
+                    texels[i][0] = colors[i].r; texels[i][1] = colors[i].g; texels[i][2] = colors[i].b;
+                    texels[i][3] = alpha[i];
+                }
+            }
+
+            for (int i = 0; i < 16; i++) {
+                int x = bx * 4 + i % 4, y = by * 4 + i / 4;
+                if (x < width && y < height) memcpy(image.at(x, y), texels[i], 4);
+            }
+            block += blockBytes(format);
+        }
+    }
+
+    return image;
+}
+
+float computePSNR(const ImageRGBA &original, const ImageRGBA &decoded, BlockFormat format) {
+    int channels = format == BlockFormat::BC5 ? 2 : format == BlockFormat::BC1 ? 3 : 4;
+
+    double squaredError = 0.0;
+    size_t pixelCount = (size_t)original.width * original.height;
+    for (size_t p = 0; p < pixelCount; p++) {
+        for (int c = 0; c < channels; c++) {
+            double d = (double)original.pixels[p * 4 + c] - (double)decoded.pixels[p * 4 + c];
+            squaredError += d * d;
+        }
+    }
+
+    double mse = squaredError / (double)(pixelCount * channels);
+    if (mse == 0.0) return 99.0f;
+    return (float)(10.0 * log10(255.0 * 255.0 / mse));
+}
@@ -0,0 +1,53 @@
+#ifndef __TEXTURECOMPRESSOR__
+#define __TEXTURECOMPRESSOR__
+
+#include "global.h"
+
+#include "image.h"
+
+/**
+ * @file textureCompressor.h
+ * @brief CPU block compression to the BCn formats supported by GL 3.3 hardware.
+ *
+ * BC1 (DXT1): RGB, 4 bits per pixel - albedo and specular maps.
+ * BC3 (DXT5): RGBA, 8 bits per pixel - albedo maps with alpha.
+ * BC5 (RGTC2): two independent channels, 8 bits per pixel - tangent space normal maps,
+ *              where z is reconstructed in the shader.
+ *
+ * None of this touches GL, so it can run on worker threads or in headless tools.
+ */
+
+enum class BlockFormat {
+    BC1,
+    BC3,
+    BC5,
+};
+
+enum class CompressionQuality {
+    // Bounding box endpoints
+    FAST,
+    // Principal axis endpoints with least squares refinement
+    HIGH,
+};
+
+unsigned int blockBytes(BlockFormat format);
+size_t compressedSize(BlockFormat format, int width, int height);
+const char* blockFormatName(BlockFormat format);
+
+/**
+ * @brief Compresses an image into 4x4 blocks, rows of blocks bottom to top.
+ */
+vector<unsigned char> compressImage(const ImageRGBA &image, BlockFormat format, CompressionQuality quality);
+
+/**
+ * @brief Decodes compressed blocks back to RGBA. Channels the format doesn't store are
+ * decoded as the GPU would (0 for BC5 blue, 255 for alpha).
+ */
+ImageRGBA decompressImage(const unsigned char *blocks, int width, int height, BlockFormat format);
+
+/**
+ * @brief Peak signal to noise ratio in dB over the channels the format stores.
+ */
+float computePSNR(const ImageRGBA &original, const ImageRGBA &decoded, BlockFormat format);
+
+#endif /* __TEXTURECOMPRESSOR__ */
@@ -0,0 +1,66 @@
+#ifndef __UNIFORMBLOCKS__
+#define __UNIFORMBLOCKS__
+
+#include "global.h"
+
+/**
+ * @file uniformBlocks.h
+ * @brief Uniform blocks shared between shaders, with their binding points and std140
+ * layouts. Shaders get their blocks bound to these points when they are linked.
+ */
+
+enum UniformBlockBinding : unsigned int {
+    CAMERA_BLOCK = 0,
+    OBJECT_BLOCK = 1,
+};
+
+const char* const UNIFORM_BLOCK_NAMES[] = { "Camera", "Object" };
+const unsigned int UNIFORM_BLOCK_COUNT = 2;
+
+struct CameraBlock {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 viewPos;
+};
+
+struct ObjectBlock {
+    glm::mat4 model;
+    // A std140 mat3 is three vec4 columns
+    glm::vec4 normalMatrix[3];
+};
+
+// Storage blocks, only used where glExtensions.multiDrawIndirect is set
+enum StorageBlockBinding : unsigned int {
+    DRAW_BLOCK = 0,
+    // Written by the culling pass - see IndirectDraws::cull
+    COMMAND_BLOCK,
+    BOUNDS_BLOCK,
+};
+
+const char* const STORAGE_BLOCK_NAMES[] = { "Draws", "Commands", "MeshBounds" };
+const unsigned int STORAGE_BLOCK_COUNT = 3;
+
+/**
+ * @brief One mesh draw of a multi-draw batch, std430. Replaces the Object block and the
+ * mesh uniforms on that path - see IndirectDraws.
+ */
+struct DrawBlock {
+    glm::mat4 world;
+    // Columns of the normal matrix
+    glm::vec4 normal[3];
+    // Quantized position decoding, see VertexFormat
+    glm::vec4 offset;
+    glm::vec4 scale;
+    // Array layers of the material's textures, when packed
+    glm::vec4 layers;
+};
+
+/**
+ * @brief A mesh's bounds in its object's space, one per draw alongside its DrawBlock. std430.
+ */
+struct BoundsBlock {
+    glm::vec4 boundsMin;
+    glm::vec4 boundsMax;
+};
+
+#endif /* __UNIFORMBLOCKS__ */
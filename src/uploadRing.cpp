@@ -0,0 +1,95 @@
+#include "uploadRing.h"
+
+#include "glExtensions.h"
+
+void UploadRing::init(GLenum target, size_t frameSize) {
+    _target = target;
+
+    if (target == GL_UNIFORM_BUFFER) {
+        int alignment;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        _alignment = alignment;
+    } else if (target == GL_SHADER_STORAGE_BUFFER) {
+        int alignment;
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        _alignment = alignment;
+    }
+    _frameSize = align(frameSize);
+
+    glGenBuffers(1, &_buffer);
+    glBindBuffer(_target, _buffer);
+    glBufferData(_target, _frameSize * FRAMES_IN_FLIGHT, NULL, GL_STREAM_DRAW);
+    glBindBuffer(_target, 0);
+}
+
+void UploadRing::beginFrame(size_t size) {
+    glBindBuffer(_target, _buffer);
+
+    if (size > _frameSize) {
+        // New storage - the driver keeps the old one alive for draws still using it
+        _frameSize = align(size + size / 2);
+        glBufferData(_target, _frameSize * FRAMES_IN_FLIGHT, NULL, GL_STREAM_DRAW);
+        for (GLsync &fence : _fences) {
+            if (fence) glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    GLsync &fence = _fences[_frame];
+    if (fence) {
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            _stalls++;
+            do {
+                status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            } while (status == GL_TIMEOUT_EXPIRED);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    _mapped = (unsigned char*)glMapBufferRange(_target, _frame * _frameSize, _frameSize,
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+    if (!_mapped) std::cout << "ERROR::UPLOADRING::MAP_FAILED" << std::endl;
+    _used = 0;
+
+    glBindBuffer(_target, 0);
+}
+
+UploadAllocation UploadRing::allocate(size_t size) {
+    size = align(size);
+    if (!_mapped || _used + size > _frameSize) {
+        std::cout << "ERROR::UPLOADRING::OUT_OF_SPACE" << std::endl;
+        return UploadAllocation();
+    }
+
+    UploadAllocation allocation { _frame * _frameSize + _used, size, _mapped + _used };
+    _used += size;
+    return allocation;
+}
+
+void UploadRing::unmap() {
+    if (!_mapped) return;
+
+    glBindBuffer(_target, _buffer);
+    if (_used > 0) glFlushMappedBufferRange(_target, 0, _used);
+    glUnmapBuffer(_target);
+    glBindBuffer(_target, 0);
+    _mapped = nullptr;
+}
+
+void UploadRing::endFrame() {
+    unmap();
+    _fences[_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _frame = (_frame + 1) % FRAMES_IN_FLIGHT;
+}
+
+void UploadRing::release() {
+    unmap();
+    for (GLsync &fence : _fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    glDeleteBuffers(1, &_buffer);
+    _buffer = 0;
+}
@@ -0,0 +1,62 @@
+#ifndef __UPLOADRING__
+#define __UPLOADRING__
+
+#include "global.h"
+
+/**
+ * @brief A range of an UploadRing. `data` is only valid until the ring is unmapped.
+ */
+struct UploadAllocation {
+    size_t offset { 0 };
+    size_t size { 0 };
+    unsigned char *data { nullptr };
+};
+
+/**
+ * @brief Streams per frame data to the GPU through one buffer split into a region per
+ * frame in flight.
+ *
+ * Each frame maps its region unsynchronized, so the driver neither copies the data nor
+ * waits for the GPU - instead the ring waits on the fence left when the region was last
+ * used, FRAMES_IN_FLIGHT frames ago, which has normally long signalled.
+ *
+ * Usage per frame: beginFrame() with the total size, allocate() and write, unmap() before
+ * drawing with any of it, then endFrame() once the frame's draws are submitted.
+ */
+class UploadRing {
+public:
+    static const unsigned int FRAMES_IN_FLIGHT = 3;
+
+    UploadRing() {};
+    void init(GLenum target, size_t frameSize);
+
+    // Waits for this frame's region and maps it. Grows the ring first if `size` won't fit.
+    void beginFrame(size_t size);
+    // Sub-allocates from the mapped region. `size` is rounded up to the binding alignment.
+    UploadAllocation allocate(size_t size);
+    // Flushes what was written. Must be called before drawing with the data.
+    void unmap();
+    // Fences the region once the GPU is done with the frame's draws
+    void endFrame();
+    // Deletes the buffer and any fences still pending
+    void release();
+
+    unsigned int getBuffer() const { return _buffer; }
+    size_t align(size_t size) const { return (size + _alignment - 1) / _alignment * _alignment; }
+    // Frames which had to wait for the GPU to release their region
+    unsigned int getStallCount() const { return _stalls; }
+
+private:
+    GLenum _target;
+    unsigned int _buffer { 0 };
+    size_t _alignment { 1 };
+    size_t _frameSize { 0 };
+
+    GLsync _fences[FRAMES_IN_FLIGHT] {};
+    unsigned int _frame { 0 };
+    unsigned char *_mapped { nullptr };
+    size_t _used { 0 };
+    unsigned int _stalls { 0 };
+};
+
+#endif /* __UPLOADRING__ */
@@ -0,0 +1,157 @@
+#include "vertexFormat.h"
+
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+
+namespace {
+
+struct AttribLayout {
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    unsigned int bytes;
+};
+
+// Order matches the attribute locations: position, normal, texture coords, tangent
+void attribLayouts(const VertexFormat &format, AttribLayout out[4]) {
+    out[0] = format.quantizePositions
+        ? AttribLayout { 3, GL_UNSIGNED_SHORT, GL_TRUE, 4 * sizeof(uint16_t) } // padded to 8 bytes
+        : AttribLayout { 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float) };
+    out[1] = format.packNormals
+        ? AttribLayout { 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(uint32_t) }
+        : AttribLayout { 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float) };
+    out[2] = format.halfTexCoords
+        ? AttribLayout { 2, GL_HALF_FLOAT, GL_FALSE, sizeof(uint32_t) }
+        : AttribLayout { 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float) };
+    out[3] = format.packNormals
+        ? AttribLayout { 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(uint32_t) }
+        : AttribLayout { 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float) };
+}
+
+glm::vec3 safeInverse(glm::vec3 extent) {
+    return glm::vec3(
+        extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+        extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+        extent.z > 0.0f ? 1.0f / extent.z : 0.0f
+    );
+}
+
+template <typename T>
+void write(unsigned char *&dst, const T &value) {
+    memcpy(dst, &value, sizeof(T));
+    dst += sizeof(T);
+}
+
+template <typename T>
+T read(const unsigned char *&src) {
+    T value;
+    memcpy(&value, src, sizeof(T));
+    src += sizeof(T);
+    return value;
+}
+
+}
+
+unsigned int VertexFormat::stride() const {
+    AttribLayout layouts[4];
+    attribLayouts(*this, layouts);
+    return layouts[0].bytes + layouts[1].bytes + layouts[2].bytes + layouts[3].bytes;
+}
+
+/**
+ * @brief Sets up attribute pointers 0-3 on the currently bound VAO, reading from the
+ * currently bound GL_ARRAY_BUFFER.
+ */
+void VertexFormat::configureAttributes() const {
+    AttribLayout layouts[4];
+    attribLayouts(*this, layouts);
+
+    unsigned int vertexStride = stride();
+    unsigned int offset = 0;
+    for (unsigned int i = 0; i < 4; i++) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribPointer(i, layouts[i].size, layouts[i].type, layouts[i].normalized, vertexStride, (void*)(size_t)offset);
+        offset += layouts[i].bytes;
+    }
+}
+
+/**
+ * @brief Interleaves vertices into a buffer laid out for this format.
+ *
+ * @param boundsMin, boundsMax Mesh AABB, only used when quantizing positions.
+ */
+vector<unsigned char> VertexFormat::pack(const vector<Vertex> &vertices, glm::vec3 boundsMin, glm::vec3 boundsMax) const {
+    vector<unsigned char> data(vertices.size() * stride());
+    glm::vec3 invExtent = safeInverse(boundsMax - boundsMin);
+
+    unsigned char *dst = data.data();
+    for (const Vertex &v : vertices) {
+        if (quantizePositions) {
+            glm::vec3 norm = (v.Position - boundsMin) * invExtent;
+            write(dst, glm::packUnorm4x16(glm::vec4(norm, 0.0f)));
+        } else {
+            write(dst, v.Position);
+        }
+
+        if (packNormals) {
+            write(dst, glm::packSnorm3x10_1x2(glm::vec4(v.Normal, 0.0f)));
+        } else {
+            write(dst, v.Normal);
+        }
+
+        if (halfTexCoords) {
+            write(dst, glm::packHalf2x16(v.TexCoords));
+        } else {
+            write(dst, v.TexCoords);
+        }
+
+        float sign = v.BitangentSign < 0.0f ? -1.0f : 1.0f;
+        if (packNormals) {
+            write(dst, glm::packSnorm3x10_1x2(glm::vec4(v.Tangent, sign)));
+        } else {
+            write(dst, glm::vec4(v.Tangent, sign));
+        }
+    }
+
+    return data;
+}
+
+/**
+ * @brief Inverse of pack(), decoding values the same way the GPU would. Used to measure
+ * quantization error.
+ */
+vector<Vertex> VertexFormat::unpack(const vector<unsigned char> &data, glm::vec3 boundsMin, glm::vec3 boundsMax) const {
+    unsigned int vertexStride = stride();
+    vector<Vertex> vertices(data.size() / vertexStride);
+    glm::vec3 extent = boundsMax - boundsMin;
+
+    const unsigned char *src = data.data();
+    for (Vertex &v : vertices) {
+        if (quantizePositions) {
+            glm::vec4 norm = glm::unpackUnorm4x16(read<glm::uint64>(src));
+            v.Position = boundsMin + glm::vec3(norm) * extent;
+        } else {
+            v.Position = read<glm::vec3>(src);
+        }
+
+        if (packNormals) {
+            v.Normal = glm::vec3(glm::unpackSnorm3x10_1x2(read<glm::uint32>(src)));
+        } else {
+            v.Normal = read<glm::vec3>(src);
+        }
+
+        if (halfTexCoords) {
+            v.TexCoords = glm::unpackHalf2x16(read<glm::uint32>(src));
+        } else {
+            v.TexCoords = read<glm::vec2>(src);
+        }
+
+        glm::vec4 tangent = packNormals
+            ? glm::unpackSnorm3x10_1x2(read<glm::uint32>(src))
+            : read<glm::vec4>(src);
+        v.Tangent = glm::vec3(tangent);
+        v.BitangentSign = tangent.w < 0.0f ? -1.0f : 1.0f;
+    }
+
+    return vertices;
+}
@@ -0,0 +1,57 @@
+#ifndef __VERTEXFORMAT__
+#define __VERTEXFORMAT__
+
+#include "global.h"
+
+struct Vertex {
+    glm::vec3 Position;
+    glm::vec3 Normal;
+    glm::vec2 TexCoords;
+    glm::vec3 Tangent;
+    // Handedness of the tangent frame: bitangent = cross(Normal, Tangent) * BitangentSign
+    float BitangentSign { 1.0f };
+};
+
+/**
+ * @brief Describes how the attributes of a Vertex are laid out in GPU memory.
+ *
+ * The default format uploads everything as full precision floats. Each attribute
+ * can be packed independently:
+ *  - normals and tangents as GL_INT_2_10_10_10_REV, with the bitangent sign in w
+ *  - texture coords as two half floats
+ *  - positions as 16-bit unsigned normalized ints, relative to the mesh AABB. Shaders
+ *    must decode these with the `positionOffset` and `positionScale` uniforms.
+ *
+ * Attribute locations are the same for every format: 0 position, 1 normal,
+ * 2 texture coords, 3 tangent (w = bitangent sign).
+ */
+struct VertexFormat {
+    bool packNormals { false };
+    bool halfTexCoords { false };
+    bool quantizePositions { false };
+
+    /**
+     * @brief Everything packed - 20 bytes per vertex, or 24 with float positions.
+     */
+    static VertexFormat compact(bool quantizePositions = true) {
+        VertexFormat format;
+        format.packNormals = true;
+        format.halfTexCoords = true;
+        format.quantizePositions = quantizePositions;
+        return format;
+    }
+
+    bool operator==(const VertexFormat &other) const {
+        return packNormals == other.packNormals
+            && halfTexCoords == other.halfTexCoords
+            && quantizePositions == other.quantizePositions;
+    }
+    bool operator!=(const VertexFormat &other) const { return !(*this == other); }
+
+    unsigned int stride() const;
+    void configureAttributes() const;
+    vector<unsigned char> pack(const vector<Vertex> &vertices, glm::vec3 boundsMin, glm::vec3 boundsMax) const;
+    vector<Vertex> unpack(const vector<unsigned char> &data, glm::vec3 boundsMin, glm::vec3 boundsMax) const;
+};
+
+#endif /* __VERTEXFORMAT__ */